@@ -0,0 +1,37 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+namespace CPU
+{
+    // percpu_counter style: updates land in the local CPU's slot and are folded into the shared total once they exceed the batch.
+    // batch <= 1 (or an uninitialized counter) skips the slots and keeps the shared total exact.
+    class LIBLINUX_CLS OPerCpuCounter
+    {
+    public:
+        OPerCpuCounter();
+        ~OPerCpuCounter();
+
+        error_t Init(int64_t batch = 32);
+
+        void Add(int64_t delta);
+        void Increment() { Add(1);  }
+        void Decrement() { Add(-1); }
+
+        int64_t Read(); // cheap; off by at most (batch - 1) * cpus
+        int64_t Sum();  // walks every slot; exact once updates have quiesced
+
+    private:
+        __declspec(align(64)) volatile int64_t _global;    // own line; read on hot paths
+        struct PerCpuSlot * _slots;
+        void * _allocation;
+        uint32_t _cpus;
+        int64_t _batch;
+    };
+
+    LIBLINUX_SYM uint32_t GetPossibleCPUs();   // nr_cpu_ids
+    LIBLINUX_SYM uint32_t GetCurrentCPU();     // clamped to [0, GetPossibleCPUs())
+}
@@ -4,12 +4,14 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #pragma once
+#include <Core/Synchronization/OWaitable.hpp>
+#include <Core/CPU/OThreadStats.hpp>
 
 namespace CPU
 {
     namespace Threading
     {
-        class OThread : public OObject
+        class OThread : public OObject, public Synchronization::OWaitable
         {
         public:
             virtual error_t GetExitCode(int64_t &) = 0;
@@ -30,6 +32,8 @@ namespace CPU
             virtual error_t IsFloatingHandle(bool &) = 0;
             virtual error_t GetOSHandle(void *& handle) = 0;
 
+            virtual error_t GetStats(ThreadStats_t & stats) = 0;
+
             virtual void * GetData() = 0;
         };
 
@@ -69,5 +73,9 @@ namespace CPU
         typedef void(*OThreadEP_t)(ThreadMsg_ref);
 
         LIBLINUX_SYM error_t SpawnOThread(const OOutlivableRef<OThread> & thread, OThreadEP_t entrypoint, const char * name, void * data);
+
+        // creates count threads in parallel and waits for them once. data may be null, otherwise data[i] is handed to thread i.
+        // on failure, the threads that did start are still returned (the rest are nullptr) and the caller owns them
+        LIBLINUX_SYM error_t SpawnOThreads(OThread ** threads, size_t count, OThreadEP_t entrypoint, const char * name, void ** data);
     }
 }
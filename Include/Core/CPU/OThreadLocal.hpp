@@ -0,0 +1,24 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+#define THREAD_LOCAL_SLOTS 64
+
+namespace CPU
+{
+    namespace Threading
+    {
+        typedef uint32_t ThreadLocalSlot_t;
+        typedef void(*ThreadLocalDtor_f)(void * value);
+
+        // Slots are allocated once (typically at module init) and never released; each is a fixed index into a per task array.
+        // Any task may use them, not just OThreads. Non-null values are handed to dtor by the exit path of the task that set them.
+        LIBLINUX_SYM error_t AllocateThreadLocal(ThreadLocalSlot_t & slot, ThreadLocalDtor_f dtor = nullptr);
+
+        LIBLINUX_SYM error_t GetThreadLocal(ThreadLocalSlot_t slot, void *& value);  // nullptr if the calling task never set it
+        LIBLINUX_SYM error_t SetThreadLocal(ThreadLocalSlot_t slot, void * value);
+    }
+}
@@ -0,0 +1,38 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/Synchronization/OWaitable.hpp>
+
+namespace CPU
+{
+    namespace Threading
+    {
+        typedef void(*PoolTask_f)(void * context);
+
+        typedef struct PoolTask_s
+        {
+            PoolTask_f callback;
+            void *     context;
+        } PoolTask_t, *PoolTask_p;
+
+        // Tracks every task of one submission. May be destroyed before its tasks have run.
+        class OPoolCompletion : public OObject, public Synchronization::OWaitable
+        {
+        public:
+            virtual error_t Wait(uint32_t ms = -1)          = 0;
+            virtual error_t WaitUntil(uint64_t deadline)    = 0; // absolute DateHelpers::GetBootTime() ns, -1 = infinite
+            virtual error_t GetPending(uint32_t & tasks)    = 0;
+        };
+
+        // Module-wide pool, one worker per possible CPU. Tasks submitted from a worker go to its own deque and are the first to be stolen by idle workers;
+        // everything else goes through a shared injection queue. Tasks must not sleep for long - they hold up everything queued behind them on that worker.
+        LIBLINUX_SYM error_t SubmitPoolTask(PoolTask_f callback, void * context);
+        LIBLINUX_SYM error_t SubmitPoolTask(PoolTask_f callback, void * context, const OOutlivableRef<OPoolCompletion> & completion);
+        LIBLINUX_SYM error_t SubmitPoolTasks(const PoolTask_t * tasks, size_t count, const OOutlivableRef<OPoolCompletion> & completion);
+
+        LIBLINUX_SYM uint32_t GetPoolWorkers();
+    }
+}
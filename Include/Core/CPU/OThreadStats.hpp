@@ -0,0 +1,26 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+namespace CPU
+{
+    namespace Threading
+    {
+        // snapshot of the task_struct accounting fields; read without locks, so fields may be mutually off by a tick. times are in ns
+        typedef struct ThreadStats_s
+        {
+            uint32_t threadId;
+            uint32_t lastCpu;               // task_cpu
+            uint64_t userTime;              // utime
+            uint64_t systemTime;            // stime
+            uint64_t runtime;               // se.sum_exec_runtime
+            uint64_t voluntarySwitches;     // nvcsw
+            uint64_t involuntarySwitches;   // nivcsw
+            uint64_t runDelay;              // sched_info.run_delay - time spent runnable, waiting on a run queue (0 without CONFIG_SCHED_INFO)
+            uint64_t timeslices;            // sched_info.pcount
+        } ThreadStats_t, *ThreadStats_p;
+    }
+}
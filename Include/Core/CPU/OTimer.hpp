@@ -0,0 +1,36 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+#define TIMER_SLACK_DEFAULT_NS (1000ull * 1000)                 // 1ms
+#define TIMER_SLACK_MAX_NS     (60ull * 1000 * 1000 * 1000)     // 1 minute
+
+namespace CPU
+{
+    namespace Threading
+    {
+        typedef void(*TimerCallback_f)(void * context);
+
+        // Callbacks are run on the module thread pool (never in atomic context) and never before the timer expires.
+        // They may run up to slack ns late, so that timers with nearby expiries share a single wakeup of the timer service.
+        // A periodic timer whose previous callback is still running when it expires again skips that period.
+        // A one-shot that expires whilst its previous callback is still running is called back once that one returns.
+        // Destroying a timer stops it; a callback that has already been dispatched may still be running.
+        class OTimer : public OObject
+        {
+        public:
+            virtual error_t Start(uint64_t delay, uint64_t period = 0)    = 0; // ns from now; period 0 = one-shot. cancels any pending expiry
+            virtual error_t Stop()                                        = 0; // doesn't wait for a callback that's already running
+            virtual error_t IsArmed(bool & armed)                         = 0;
+
+            virtual error_t SetSlack(uint64_t slack)                      = 0; // applies from the next (re)arm
+            virtual error_t GetOverruns(uint64_t & overruns)              = 0; // periodic only: periods skipped, either missed outright or with the callback still running
+        };
+
+        LIBLINUX_SYM error_t CreateTimer(TimerCallback_f callback, void * context, const OOutlivableRef<OTimer> & timer);
+        LIBLINUX_SYM error_t CreateTimer(TimerCallback_f callback, void * context, uint64_t slack, const OOutlivableRef<OTimer> & timer);
+    }
+}
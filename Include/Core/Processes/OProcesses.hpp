@@ -4,6 +4,7 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #pragma once
+#include <Core/CPU/OThreadStats.hpp>
 
 class OProcess;
 class OProcessThread : public  OObject
@@ -16,6 +17,8 @@ public:
 
     virtual error_t IsProcess(bool * out)                                                       = 0;
     virtual error_t AsProcess(const OOutlivableRef<OProcess> parent)                            = 0;
+
+    virtual error_t GetStats(CPU::Threading::ThreadStats_t * stats)                             = 0;
 };
 
 typedef bool(*ThreadIterator_cb)(const OPtr<OProcessThread> thread, void * context);
@@ -35,6 +38,8 @@ public:
     virtual uint_t  GetThreadCount()                                                            = 0;
     virtual error_t IterateThreads(ThreadIterator_cb callback, void * ctx)                      = 0;
     virtual error_t GetThreadById(uint_t id, const OOutlivableRef<OProcessThread> & thread)     = 0;
+    // one pass over the thread group. threads receives how many there were; kErrorIllegalSize (with the first count filled) if that's more than count
+    virtual error_t GetThreadStats(CPU::Threading::ThreadStats_t * stats, uint_t count, uint_t * threads) = 0;
                                                                                                 
     virtual error_t Terminate(bool force)                                                       = 0;
 
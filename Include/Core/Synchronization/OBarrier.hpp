@@ -0,0 +1,27 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+namespace Synchronization
+{
+    // Reusable rendezvous for a fixed number of threads. Each phase ends once every participant has called Arrive; the next phase starts immediately.
+    // No allocation, the last arriver wakes the rest in a single batched pass. spin = polls of the generation before falling back to sleeping.
+    class LIBLINUX_CLS OBarrier
+    {
+    public:
+        OBarrier(uint32_t participants, uint32_t spin = 0);
+
+        bool Arrive();                   // true for exactly one thread per phase: the last arriver
+        uint32_t GetGeneration();        // completed phases
+        uint32_t GetParticipants();
+
+    private:
+        uint32_t _participants;
+        uint32_t _spin;
+        volatile long _remaining;
+        volatile uint32_t _generation;
+    };
+}
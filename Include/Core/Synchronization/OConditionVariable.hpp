@@ -0,0 +1,25 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/Synchronization/OMutex.hpp>
+
+namespace Synchronization
+{
+    // Waits must be made whilst holding mutex, and every concurrent waiter must use the same mutex.
+    // With a kMutexAdaptive mutex, Broadcast wakes one waiter and requeues the rest onto the mutex (wait morphing), so they run one at a time as the mutex is handed over.
+    // kMutexSleeping mutexes fall back to waking everyone.
+    class OConditionVariable : public OObject
+    {
+    public:
+        virtual error_t Wait(OMutex * mutex, uint32_t ms = -1)         = 0;
+        virtual error_t WaitUntil(OMutex * mutex, uint64_t deadline)   = 0; // absolute DateHelpers::GetBootTime() ns, -1 = infinite. mutex is reacquired even on kStatusTimeout
+
+        virtual error_t Signal()                                       = 0;
+        virtual error_t Broadcast()                                    = 0;
+    };
+
+    LIBLINUX_SYM error_t CreateConditionVariable(const OOutlivableRef<OConditionVariable> & out);
+}
@@ -7,12 +7,34 @@
 
 namespace Synchronization
 {
+    enum MutexMode_e
+    {
+        kMutexSleeping,     // straight to the kernel mutex
+        kMutexAdaptive      // spin whilst the owner is on a CPU, then sleep
+    };
+
+    typedef struct MutexStats_s
+    {
+        uint64_t fastAcquisitions;   // uncontended
+        uint64_t spinAcquisitions;   // contended, acquired during the spin phase
+        uint64_t sleepAcquisitions;  // contended, had to sleep
+    } MutexStats_t, *MutexStats_p;
+
     class OMutex : public  OObject
     {
     public:
         virtual void Lock() = 0;
         virtual void Unlock() = 0;
+
+        virtual MutexMode_e GetMode() = 0;
+
+        // kMutexSleeping mutexes do not keep statistics and report zeros
+        virtual error_t GetStats(MutexStats_t & stats) = 0;
+
+        // opt into the lock profiler under the given name (no-op unless built with LIBOS_LOCK_PROFILING=1, which is off by default)
+        virtual error_t EnableProfiling(const char * name) = 0;
     };
 
     LIBLINUX_SYM error_t CreateMutex(const OOutlivableRef<OMutex> & mutex);
+    LIBLINUX_SYM error_t CreateMutex(MutexMode_e mode, const OOutlivableRef<OMutex> & mutex);
 }
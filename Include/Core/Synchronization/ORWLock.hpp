@@ -0,0 +1,29 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+namespace Synchronization
+{
+    class ORWLock : public OObject
+    {
+    public:
+        virtual void    ReadLock()                = 0;
+        virtual void    ReadUnlock()              = 0;
+
+        virtual void    WriteLock()               = 0;
+        virtual void    WriteUnlock()             = 0;
+
+        // kStatusOkay = acquired, kStatusTimeout = not acquired within ms (0 = single attempt)
+        virtual error_t TryReadLock(uint32_t ms)  = 0;
+        virtual error_t TryWriteLock(uint32_t ms) = 0;
+
+        // lock profiler. hold times are only tracked for writers
+        virtual error_t EnableProfiling(const char * name) = 0;
+    };
+
+    // writerPreference: waiting writers hold off new readers. otherwise readers may overlap indefinitely and starve writers.
+    LIBLINUX_SYM error_t CreateRWLock(bool writerPreference, const OOutlivableRef<ORWLock> & out);
+}
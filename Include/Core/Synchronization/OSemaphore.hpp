@@ -4,15 +4,26 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #pragma once
+#include <Core/Synchronization/OWaitable.hpp>
+#include <Core/Synchronization/OWakePolicy.hpp>
 
 namespace Synchronization
 {
-    class OCountingSemaphore : public  OObject
+    class OCountingSemaphore : public  OObject, public OWaitable
     {
     public:
         virtual error_t Wait(uint32_t ms = -1)                                                = 0;
+        virtual error_t WaitUntil(uint64_t deadline)                                          = 0; // absolute DateHelpers::GetBootTime() ns, -1 = infinite
+
+        // all or nothing acquire of count units. queued requests are served in order; a large request holds back the ones behind it rather than being starved
+        virtual error_t Wait(uint32_t count, uint32_t ms)                                     = 0;
+        virtual error_t WaitUntil(uint32_t count, uint64_t deadline)                          = 0;
         virtual error_t Trigger(uint32_t count, uint32_t & releasedThreads, uint32_t & debt)  = 0;
+
+        virtual error_t EnableProfiling(const char * name)                                    = 0; // wait times only; semaphores have no owner to measure hold times against
+        virtual error_t GetWakeStats(WakeStats_t & stats)                                     = 0;
     };
     
     LIBLINUX_SYM error_t CreateCountingSemaphore(size_t count, const OOutlivableRef<OCountingSemaphore> out);
+    LIBLINUX_SYM error_t CreateCountingSemaphore(size_t count, WakePolicy_e policy, const OOutlivableRef<OCountingSemaphore> out);
 }
@@ -0,0 +1,32 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/Synchronization/OSpinlock.hpp>
+
+namespace Synchronization
+{
+    // Sequence lock for small, read-mostly state. Readers never write to the lock, so they never bounce its cache line.
+    //
+    //  do { seq = lock.ReadBegin(); copy = shared; } while (lock.ReadRetry(seq));
+    //
+    // Readers may observe torn state inside the loop; only act on the copy once ReadRetry returns false.
+    class LIBLINUX_CLS OSeqLock
+    {
+    public:
+        OSeqLock();
+
+        uint32_t ReadBegin();            // waits out an in-progress write
+        bool     ReadRetry(uint32_t seq); // true = a writer got in, read again
+
+        void WriteLock();
+        bool TryWriteLock();
+        void WriteUnlock();
+
+    private:
+        volatile long _sequence; // odd whilst a write is in progress
+        Spinlock _writer;
+    };
+}
@@ -5,20 +5,80 @@
 */
 #pragma once
 
+#define SPINLOCK_CACHE_LINE 64
+
+struct LockProfile;
+
 namespace Synchronization
 {
+    // test-and-test-and-set. cheap, but every waiter spins on the same cache line
     class LIBLINUX_CLS Spinlock
     {
     public:
         Spinlock();
 
         void Lock();
+        bool TryLock();
         void Unlock();
         bool IsLocked();
+
+        long GetContention(); // number of Lock calls that had to spin
+
+        void EnableProfiling(const char * name); // lock profiler; leave internal/hot locks unnamed
     private:
+        void ProfileAcquired(uint64_t start, bool contended);
+
         long _value;
+        long _contention;
+        LockProfile * _profile;
+        uint64_t _acquiredAt;
+    };
+
+    // FIFO ticket lock. waiters back off in proportion to their distance from the head of the queue
+    class LIBLINUX_CLS TicketSpinlock
+    {
+    public:
+        TicketSpinlock();
+
+        void Lock();
+        bool TryLock();
+        void Unlock();
+        bool IsLocked();
+
+        long GetContention();
+    private:
+        volatile long _next;
+        volatile long _serving;
+        long _contention;
+    };
+
+    // per-acquisition queue node. usually lives on the stack of the thread holding/waiting on the lock
+    struct __declspec(align(SPINLOCK_CACHE_LINE)) QueuedSpinlockNode
+    {
+        QueuedSpinlockNode * volatile next;
+        volatile long locked;
+    };
+
+    // MCS lock. each waiter spins on its own cache-line-padded node, handing the lock off directly to its successor
+    class LIBLINUX_CLS QueuedSpinlock
+    {
+    public:
+        QueuedSpinlock();
+
+        void Lock(QueuedSpinlockNode & node);
+        bool TryLock(QueuedSpinlockNode & node);
+        void Unlock(QueuedSpinlockNode & node);
+        bool IsLocked();
+
+        long GetContention();
+    private:
+        QueuedSpinlockNode * volatile _tail;
+        long _contention;
     };
 }
 
 #define SPINLOOP_PROCYIELD() {thread_pause();            }
 #define SPINLOOP_SLEEP()     {thread_pause(); msleep(1); }
+
+// pause iterations per ticket between a waiter and the owner
+#define SPINLOOP_TICKET_BACKOFF 50
@@ -0,0 +1,32 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+namespace Synchronization
+{
+    // futex-like wait/wake on any 32-bit word. no per-object allocation; sleepers park in a global sharded hash.
+    // deadline: absolute DateHelpers::GetBootTime() ns, -1 = infinite
+    // returns kStatusOkay once woken or if *address != expected on entry, kStatusTimeout otherwise. callers must re-check their condition.
+    LIBLINUX_SYM error_t WaitOnAddress(volatile uint32_t * address, uint32_t expected, uint64_t deadline = -1);
+
+    // wakes up to count (-1 = all) threads sleeping on address. call after publishing the new value.
+    LIBLINUX_SYM error_t WakeByAddress(volatile uint32_t * address, uint32_t count, uint32_t & woken);
+
+    // one-shot completion in a single word
+    class LIBLINUX_CLS Completion
+    {
+    public:
+        Completion();
+
+        void Set();
+        bool IsSet();
+        error_t Wait(uint64_t deadline = -1); // kStatusOkay or kStatusTimeout
+
+        volatile uint32_t * GetAddress();
+    private:
+        volatile uint32_t _state;
+    };
+}
@@ -0,0 +1,36 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+#define WAIT_MULTIPLE_MAX 32
+
+namespace Synchronization
+{
+    struct WaitableObserver;
+
+    // Implemented by objects that can be passed to WaitMultiple.
+    // These are plumbing for WaitMultiple; use the object's own Wait API when blocking on a single object.
+    class OWaitable
+    {
+    public:
+        virtual bool WaitableIsSignaled()                                = 0; // peek, never consumes
+        virtual bool WaitableTryAcquire()                                = 0; // consume one signal if available (semaphores take a unit; everything else just peeks)
+        virtual void WaitableRelease()                                   = 0; // give back a successful WaitableTryAcquire (kWaitAll back-out)
+
+        virtual void WaitableAddObserver(WaitableObserver * observer)    = 0;
+        virtual void WaitableRemoveObserver(WaitableObserver * observer) = 0;
+    };
+
+    enum WaitMultipleMode_e
+    {
+        kWaitAny,   // return once any object fires; index = the object that was acquired
+        kWaitAll    // return once every object has been acquired together
+    };
+
+    // deadline: absolute DateHelpers::GetBootTime() ns, -1 = infinite
+    // returns kStatusOkay or kStatusTimeout
+    LIBLINUX_SYM error_t WaitMultiple(OWaitable ** objects, size_t count, WaitMultipleMode_e mode, uint64_t deadline, size_t & index);
+}
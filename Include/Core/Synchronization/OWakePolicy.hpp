@@ -0,0 +1,29 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+namespace Synchronization
+{
+    enum WakePolicy_e
+    {
+        kWakeFifo,          // oldest waiter first
+        kWakeLifo,          // most recently parked waiter first - its cache and TLB are still warm, the rest stay asleep longer
+        kWakeCpuLocal       // prefer a waiter that parked on the waking CPU, otherwise the oldest
+    };
+
+    typedef struct WakeStats_s
+    {
+        uint64_t wakes;         // waiters handed off to
+        uint64_t localWakes;    // ...of which parked on the waking CPU
+    } WakeStats_t, *WakeStats_p;
+
+    // opt-in busy-poll before sleeping, for waits that usually complete within a few tens of microseconds
+    typedef struct PollStats_s
+    {
+        uint64_t pollHits;      // condition met whilst polling
+        uint64_t sleeps;        // budget ran out, went to sleep
+    } PollStats_t, *PollStats_p;
+}
@@ -4,6 +4,8 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #pragma once
+#include <Core/Synchronization/OWaitable.hpp>
+#include <Core/Synchronization/OWakePolicy.hpp>
 
 namespace Synchronization
 {
@@ -15,12 +17,13 @@ namespace Synchronization
         return err == kStatusOkay || err == kStatusWorkQueueAlreadyComplete;
     }
 
-    class OWorkQueue : public OObject
+    class OWorkQueue : public OObject, public OWaitable
     {
     public:
         virtual error_t GetCount(uint32_t &) = 0;
 
         virtual error_t WaitAndAddOwner(uint32_t ms = -1, SpuriousWakeup_f wakeup = nullptr) = 0;  // check return value against IsWorkQueueOwner(...) to determine ownership
+        virtual error_t WaitAndAddOwnerUntil(uint64_t deadline, SpuriousWakeup_f wakeup = nullptr) = 0;  // absolute DateHelpers::GetBootTime() ns, -1 = infinite
         virtual error_t ReleaseOwner() = 0;
 
         virtual error_t SpuriousWakeupOwners() = 0;
@@ -28,6 +31,12 @@ namespace Synchronization
         virtual error_t EndWork() = 0;
         virtual error_t BeginWork() = 0;
 
+        virtual error_t GetWakeStats(WakeStats_t & stats) = 0;
+
+        // busy-poll for up to ns before parking (0 = off, the default). capped at 1ms. only the wake signal is polled, the SpuriousWakeup_f is asked once before sleeping
+        virtual error_t SetPollBudget(uint64_t ns) = 0;
+        virtual error_t GetPollStats(PollStats_t & stats) = 0;
+
         // Non-reusable APIs, or at least, not as safe. Do not use these unless you're certain that your work load will not break thread safety conditions.
         void Trigger()
         {
@@ -43,6 +52,15 @@ namespace Synchronization
                 ReleaseOwner();
             return ret;
         }
+
+        error_t DumbWaitUntil(uint64_t deadline)
+        {
+            error_t ret;
+            ret = WaitAndAddOwnerUntil(deadline);
+            if (IsWorkQueueOwner(ret))
+                ReleaseOwner();
+            return ret;
+        }
     };
 
     // A work queue is essentially a reusable work queue with infinite waiters and a set amount of tasks
@@ -66,5 +84,7 @@ namespace Synchronization
     //
     // This implementation completely differs from such
 
+    // policy orders the owners woken on completion, and picks which parked workers get the freed work slots
     LIBLINUX_SYM error_t CreateWorkQueue(size_t work_items, const OOutlivableRef<OWorkQueue> out);
+    LIBLINUX_SYM error_t CreateWorkQueue(size_t work_items, WakePolicy_e policy, const OOutlivableRef<OWorkQueue> out);
 }
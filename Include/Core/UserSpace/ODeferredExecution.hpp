@@ -4,6 +4,8 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #pragma once
+#include <Core/Synchronization/OWaitable.hpp>
+#include <Core/Synchronization/OWakePolicy.hpp>
 class OProcessThread;
 
 struct ODEParameters
@@ -32,7 +34,7 @@ struct ODEWork
 
 typedef void(* ODECompleteCallback_f)(void * context);
 
-class ODEWorkJob : public OObject
+class ODEWorkJob : public OObject, public Synchronization::OWaitable
 {
 public:
     virtual error_t SetWork(ODEWork &)                                     = 0;
@@ -43,9 +45,14 @@ public:
     virtual error_t HasExecuted(bool &)                                    = 0;
                                                                            
     virtual error_t WaitExecute(uint32_t ms = -1)                          = 0; // > 1 waiters allowed
+    virtual error_t WaitExecuteUntil(uint64_t deadline)                    = 0; // absolute DateHelpers::GetBootTime() ns, -1 = infinite
     virtual error_t AwaitExecute(ODECompleteCallback_f cb, void * context) = 0; // only one call back is allowed
 
     virtual error_t GetResponse(size_t & ret)                              = 0;
+
+    // WaitExecute busy-polls for up to ns before sleeping (0 = off, the default). capped at 1ms
+    virtual error_t SetPollBudget(uint64_t ns)                             = 0;
+    virtual error_t GetPollStats(Synchronization::PollStats_t & stats)    = 0;
 };
 
 LIBLINUX_SYM error_t CreateWorkItem(OPtr<OProcessThread> target, const OOutlivableRef<ODEWorkJob> out);
@@ -24,10 +24,7 @@
 static inline uint32_t MSToOSTicks(uint64_t ms)
 {
     uint64_t HZ = kernel_information.KERNEL_FREQUENCY;
-    if (ms > 1000)
-        return uint32_t(HZ * ms / 1000);
-    else
-        return uint32_t(HZ / (1000 / ms));
+    return uint32_t(HZ * ms / 1000);
 }
 
 struct time_info
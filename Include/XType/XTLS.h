@@ -4,22 +4,79 @@
     License: All Rights Reserved J. Reece Wilson
 */  
 #pragma once
+#include <Core/CPU/OThreadLocal.hpp>
 
-//XStaticVar - to be used in functions 
-//XStatic
+// Typed per task value. Init() once, then Get() default constructs the calling task's instance on first use.
+// Every instance is deleted by the exit path of the task that owns it.
+template <typename T>
+class ThreadLocal
+{
+public:
+    ThreadLocal() : _slot(THREAD_LOCAL_SLOTS)
+    {}
 
-#define GLOBAL_PER_THREAD(name, type)
-#define LOCAL_STATIC_VAR(name, type)
+    error_t Init()
+    {
+        return CPU::Threading::AllocateThreadLocal(_slot, Destruct);
+    }
 
+    // nullptr if the calling task hasn't created one yet
+    T * Peek()
+    {
+        void * value;
 
+        if (ERROR(CPU::Threading::GetThreadLocal(_slot, value)))
+            return nullptr;
 
-//ideas:
+        return static_cast<T *>(value);
+    }
 
-void test()
-{
-	ThreadLocalStack<void *> a(0x123);
-	ThreadLocalIP<void *> b();
-	ThreadIndexor<int> c(5 /*5 threads will access this array. any more = panic*/);
+    // nullptr if not initialized or out of memory
+    T * Get()
+    {
+        error_t err;
+        void * value;
+        T * instance;
+
+        err = CPU::Threading::GetThreadLocal(_slot, value);
+        if (ERROR(err))
+            return nullptr;
+
+        if (value)
+            return static_cast<T *>(value);
+
+        instance = new T();
+        if (!instance)
+            return nullptr;
+
+        err = CPU::Threading::SetThreadLocal(_slot, instance);
+        if (ERROR(err))
+        {
+            delete instance;
+            return nullptr;
+        }
+
+        return instance;
+    }
+
+    // drops the calling task's instance early
+    void Reset()
+    {
+        T * instance;
+
+        instance = Peek();
+        if (!instance)
+            return;
+
+        CPU::Threading::SetThreadLocal(_slot, nullptr);
+        delete instance;
+    }
+
+private:
+    static void Destruct(void * value)
+    {
+        delete static_cast<T *>(value);
+    }
 
-	c.
-}
\ No newline at end of file
+    CPU::Threading::ThreadLocalSlot_t _slot;
+};
@@ -0,0 +1,103 @@
+/*
+    Purpose: Per-CPU sharded counter
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "OPerCpuCounter.hpp"
+
+static uint32_t possible_cpus;
+
+uint32_t CPU::GetPossibleCPUs()
+{
+    int * count;
+
+    if (possible_cpus)
+        return possible_cpus;
+
+    count = reinterpret_cast<int *>(kallsyms_lookup_name("nr_cpu_ids"));
+    possible_cpus = (count && (*count > 0)) ? uint32_t(*count) : 1;
+    return possible_cpus;
+}
+
+uint32_t CPU::GetCurrentCPU()
+{
+    uint32_t cpu;
+
+    cpu = uint32_t(xenus_util_get_cpuid());
+    return cpu < GetPossibleCPUs() ? cpu : 0;
+}
+
+CPU::OPerCpuCounter::OPerCpuCounter() : _global(0), _slots(nullptr), _allocation(nullptr), _cpus(0), _batch(1)
+{}
+
+CPU::OPerCpuCounter::~OPerCpuCounter()
+{
+    if (_allocation)
+        free(_allocation);
+}
+
+error_t CPU::OPerCpuCounter::Init(int64_t batch)
+{
+    uint32_t cpus;
+    void * allocation;
+
+    if (_slots)
+        return kErrorInternalError;
+
+    _batch = batch;
+
+    if (batch <= 1)
+        return kStatusOkay;
+
+    cpus = GetPossibleCPUs();
+
+    // one slot per line; over-allocate to line up the first
+    allocation = zalloc(sizeof(PerCpuSlot) * (cpus + 1));
+    if (!allocation)
+        return kErrorOutOfMemory;
+
+    _allocation = allocation;
+    _cpus       = cpus;
+    _slots      = reinterpret_cast<PerCpuSlot *>((size_t(allocation) + PER_CPU_CACHE_LINE - 1) & ~size_t(PER_CPU_CACHE_LINE - 1));
+
+    return kStatusOkay;
+}
+
+void CPU::OPerCpuCounter::Add(int64_t delta)
+{
+    PerCpuSlot * slot;
+    int64_t local;
+
+    if (!_slots)
+    {
+        _InterlockedExchangeAdd64(&_global, delta);
+        return;
+    }
+
+    // atomic even though the slot is "ours" - we may have migrated since picking it
+    slot  = &_slots[GetCurrentCPU()];
+    local = _InterlockedExchangeAdd64(&slot->value, delta) + delta;
+
+    if ((local < _batch) && (local > -_batch))
+        return;
+
+    _InterlockedExchangeAdd64(&_global, _InterlockedExchange64(&slot->value, 0));
+}
+
+int64_t CPU::OPerCpuCounter::Read()
+{
+    return _global;
+}
+
+int64_t CPU::OPerCpuCounter::Sum()
+{
+    int64_t sum;
+
+    sum = _global;
+
+    for (uint32_t i = 0; i < _cpus; i++)
+        sum += _slots[i].value;
+
+    return sum;
+}
@@ -0,0 +1,17 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/CPU/OPerCpuCounter.hpp>
+
+#define PER_CPU_CACHE_LINE 64
+
+struct __declspec(align(PER_CPU_CACHE_LINE)) CPU::PerCpuSlot
+{
+    volatile int64_t value;
+};
+
+LIBLINUX_SYM uint32_t CPU::GetPossibleCPUs();
+LIBLINUX_SYM uint32_t CPU::GetCurrentCPU();
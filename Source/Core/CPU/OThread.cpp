@@ -5,32 +5,59 @@
 */  
 #include <libos.hpp>
 #include "OThread.hpp"
+#include "OThreadLocal.hpp"
+#include "OThreadExit.hpp"
 #include "../Processes/OProcesses.hpp"
+#include "../Processes/OProcessHelpers.hpp"
+#include "../Synchronization/OWaitable.hpp"
 #include <Core/Synchronization/OSpinlock.hpp>
-#include <Core/Synchronization/OSemaphore.hpp>
+#include <Core/Synchronization/OWaitOnAddress.hpp>
+#include <Core/CPU/OPerCpuCounter.hpp>
 #include <ITypes/IThreadStruct.hpp>
 #include <ITypes/ITask.hpp>
+#include "../../Utils/RCU.hpp"
 
-static void * thread_dealloc_mutex;
-static void * thread_chain_mutex;
-static chain_p thread_handle_chain;
-static chain_p thread_ep_chain;
-static /*atomic*/ long closing_threads;
+#define THREAD_REGISTRY_SHARDS 256 // power of two
 
+// one per OThread spawned task (or any other task using thread locals). freed (after a grace period) by the exit path once it has finished with it
+struct ThreadRegistryEntry
+{
+    RCU::Head rcu;                              // must remain first
+    ThreadRegistryEntry * volatile next;
+    uint32_t pid;
+    void * locals;                              // ThreadLocalBlock; only ever touched by the task itself
+    CPU::Threading::OThreadEP_t entrypoint;     // null for tasks that only registered for thread locals
+    OThreadImp * instance;                      // protected by the shard lock; cleared if the handle dies first
+    long killCode;                              // written before killPending is raised
+    volatile long killPending;                  // claimed (exchanged back to zero) by exactly one of the hook or the exit path
+};
+
+// every task exit in the system looks itself up here; unrelated pids land on different locks and lines
+struct __declspec(align(SPINLOCK_CACHE_LINE)) ThreadRegistryShard
+{
+    Synchronization::Spinlock lock;             // writers only
+    ThreadRegistryEntry * volatile head;
+    volatile long kills;                        // outstanding TryMurders against tasks in this shard
+};
+
+static ThreadRegistryShard thread_registry[THREAD_REGISTRY_SHARDS];
+static CPU::OPerCpuCounter closing_threads;  // read on every context switch; zero unless some TryMurder is outstanding
+
+static ThreadRegistryShard * ThreadRegistryShardOf(uint32_t pid)
+{
+    return &thread_registry[((pid * 0x9E3779B1u) >> 24) & (THREAD_REGISTRY_SHARDS - 1)];
+}
+
+// lives on the spawner's stack (or batch allocation) until created is set; the child must not touch it afterwards
 typedef struct ThreadPrivData_s
 {
     CPU::Threading::OThreadEP_t entrypoint;
     void * data;
     const char * name;
+    OThreadImp * instance;                  // OUT
+    Synchronization::Completion created;    // set once instance is valid and kMsgThreadCreate has been delivered
 } ThreadPrivData_t, *ThreadPrivData_p;
 
-struct 
-{
-    mutex_k mutex;
-    Synchronization::OCountingSemaphore * semaphore;
-    OThreadImp * instance;
-} sync_thread_create;
-
 OThreadImp::OThreadImp(task_k tsk, uint32_t id, const char * name, const void * data)
 {
     this->_tsk  = tsk;
@@ -42,6 +69,8 @@ OThreadImp::OThreadImp(task_k tsk, uint32_t id, const char * name, const void *
         memcpy(this->_name, name, MIN(strlen(name), sizeof(this->_name) - 1));
 
     this->_try_kill = false;
+    this->_registry = nullptr;
+    WaitListInit(&this->_observers);
 }
 
 error_t OThreadImp::GetExitCode(int64_t & code)
@@ -150,6 +179,25 @@ error_t OThreadImp::GetThreadId(uint32_t & id)
     return _tsk == nullptr ? kErrorGenericFailure : kStatusOkay;
 }
 
+error_t OThreadImp::GetStats(CPU::Threading::ThreadStats_t & stats)
+{
+    CHK_DEAD;
+
+    // _tsk is only cleared by the exit path (under the same lock) while the task_struct is still valid
+    Lock();
+
+    if (!_tsk)
+    {
+        Unlock();
+        return kErrorTaskNull;
+    }
+
+    ProcessesGetTaskStats(_tsk, stats);
+    Unlock();
+
+    return kStatusOkay;
+}
+
 void * OThreadImp::GetData()
 {
     return nullptr;
@@ -160,40 +208,78 @@ void OThreadImp::SignalDead(long exitcode)
     Lock();
     _tsk = nullptr;
     _exit_code = exitcode;
+    WaitableNotifyObservers(&_observers);
     Unlock();
 }
 
 error_t OThreadImp::TryMurder(long exitcode)
 {
+    ThreadRegistryShard * shard;
+
     CHK_DEAD;
 
+    // same order as the exit path (shard, then task holder); keeps _registry alive while we flag it
+    shard = ThreadRegistryShardOf(_id);
+    shard->lock.Lock();
     Lock();
 
-    if (!_tsk)
+    if (!_tsk || !_registry)
     {
         Unlock();
+        shard->lock.Unlock();
         return kErrorTaskNull;
     }
 
     if (this->_try_kill)
     {
         Unlock();
+        shard->lock.Unlock();
         return kStatusAlreadyExiting;
     }
 
     this->_try_kill = true;
 
-    *_death_code = exitcode;
-    _InterlockedIncrement(&closing_threads);
-    *_death_signal = _id;
+    _registry->killCode = exitcode;
+    _InterlockedIncrement(&shard->kills);
+    closing_threads.Increment();
+    _InterlockedExchange(&_registry->killPending, 1);
 
     // poke the thread to ensure our post context switch handler is called within the next year or so...
     wake_up_process(this->_tsk); 
 
     Unlock();
+    shard->lock.Unlock();
     return XENUS_STATUS_NOT_ACCURATE_ASSUME_OKAY;
 }
 
+bool OThreadImp::WaitableIsSignaled()
+{
+    return _tsk == nullptr;
+}
+
+bool OThreadImp::WaitableTryAcquire()
+{
+    return WaitableIsSignaled();
+}
+
+void OThreadImp::WaitableRelease()
+{
+}
+
+void OThreadImp::WaitableAddObserver(Synchronization::WaitableObserver * observer)
+{
+    Lock();
+    WaitListAppend(&_observers, &observer->node);
+    Unlock();
+}
+
+void OThreadImp::WaitableRemoveObserver(Synchronization::WaitableObserver * observer)
+{
+    Lock();
+    WaitListRemove(&_observers, &observer->node);
+    Unlock();
+}
+
 void OThreadImp::Lock()
 {
     _task_holder.Lock();
@@ -205,187 +291,245 @@ void OThreadImp::Unlock()
     _task_holder.Unlock();
 }
 
-void OThreadImp::InvalidateImp()
+// under RCU::ReadLock or the shard lock
+static ThreadRegistryEntry * ThreadRegistryFind(ThreadRegistryShard * shard, uint32_t pid)
 {
-    mutex_lock(thread_dealloc_mutex);
-    chain_deallocate_search(thread_handle_chain, this->_id);
-    mutex_unlock(thread_dealloc_mutex);
-}
+    for (ThreadRegistryEntry * cur = RCU::Dereference(shard->head); cur; cur = RCU::Dereference(cur->next))
+    {
+        if (cur->pid == pid)
+            return cur;
+    }
 
-long ** OThreadImp::DeathSignal()
-{
-    return &_death_signal;
+    return nullptr;
 }
 
-long ** OThreadImp::DeathCode()
+static void ThreadRegistryInsert(ThreadRegistryEntry * entry)
 {
-    return &_death_code;
+    ThreadRegistryShard * shard;
+
+    shard = ThreadRegistryShardOf(entry->pid);
+
+    shard->lock.Lock();
+    entry->next = shard->head;
+    RCU::AssignPointer(shard->head, entry);
+    shard->lock.Unlock();
 }
 
-void InitThreading()
+// under the shard lock
+static ThreadRegistryEntry * ThreadRegistryUnlink(ThreadRegistryShard * shard, uint32_t pid)
 {
-    error_t err;
+    ThreadRegistryEntry * cur;
+    ThreadRegistryEntry * volatile * link;
 
-    err = chain_allocate(&thread_handle_chain);
-    if (ERROR(err))
-        panic("Couldn't create thread handle tracking chain");
+    for (link = &shard->head; (cur = *link) != nullptr; link = &cur->next)
+    {
+        if (cur->pid == pid)
+        {
+            // readers already on cur still see a valid next pointer
+            RCU::AssignPointer(*link, static_cast<ThreadRegistryEntry *>(cur->next));
+            return cur;
+        }
+    }
 
-    err = chain_allocate(&thread_ep_chain);
-    if (ERROR(err))
-        panic("Couldn't create thread ep tracking chain");
+    return nullptr;
+}
 
-    sync_thread_create.mutex = mutex_create();
-    ASSERT(sync_thread_create.mutex, "couldn't allocate mutex");
+void OThreadImp::InvalidateImp()
+{
+    ThreadRegistryShard * shard;
 
-    err = CreateCountingSemaphore(0, sync_thread_create.semaphore);
-    ASSERT(NO_ERROR(err), "couldn't create semaphore");
+    shard = ThreadRegistryShardOf(_id);
 
-    thread_chain_mutex   = mutex_create();
-    thread_dealloc_mutex = mutex_create();
+    // the exit path signals us under the same lock, so it can't be mid SignalDead once we're detached
+    shard->lock.Lock();
+    if (_registry)
+    {
+        _registry->instance = nullptr;
+        _registry = nullptr;
+    }
+    shard->lock.Unlock();
+}
 
-    ASSERT(thread_chain_mutex, "couldn't allocate mutex");
-    ASSERT(thread_dealloc_mutex, "couldn't allocate mutex");
+static void ThreadRegistryFree(RCU::Head * head)
+{
+    free(head);
 }
 
-static void ThreadExitNtfyEP(uint32_t pid, long exitcode)
+// whoever exchanged killPending back to zero retires the kill exactly once
+static void ThreadRegistryRetireKill(ThreadRegistryShard * shard)
 {
-    error_t ret;
-    CPU::Threading::OThreadEP_t * ep_tracker;
-    link_p link;
+    _InterlockedDecrement(&shard->kills);
+    closing_threads.Decrement();
+}
 
-    ret = chain_get(thread_ep_chain, pid, &link, (void **)&ep_tracker);
-    if (ERROR(ret))
-        return;
+static void ThreadExitNtfyEP(ThreadRegistryEntry * entry, long exitcode)
+{
+    CPU::Threading::ThreadMsg_t msg;
 
-    // ntfy thread exit
-    {
-        CPU::Threading::ThreadMsg_t msg;
-        msg.type = CPU::Threading::kMsgThreadExit;
-        msg.exit.thread_id = thread_geti();
-        msg.exit.code = exitcode;
-        (*ep_tracker)(&msg);
-    }
+    if (!entry->entrypoint)
+        return;
 
-    // remove ep from chain
-    {
-        chain_deallocate_handle(link);
-    }
+    msg.type = CPU::Threading::kMsgThreadExit;
+    msg.exit.thread_id = entry->pid;
+    msg.exit.code = exitcode;
+    entry->entrypoint(&msg);
 }
 
-static void ThreadExitNtfyObject(uint32_t pid, long exitcode)
+static void ThreadExitNtfyObject(ThreadRegistryShard * shard, ThreadRegistryEntry * entry, long exitcode)
 {
-    error_t ret;
-    link_p link;
-    OThreadImp ** thread_handle;
-
-    mutex_lock(thread_dealloc_mutex);
-    ret = chain_get(thread_handle_chain, pid, &link, (void **)&thread_handle);
-    if (NO_ERROR(ret))
+    // try notify othreadimpl that its controlling a dead handle, if not already nuked from a dumb pointer.
+    shard->lock.Lock();
+    if (entry->instance)
     {
-        (*thread_handle)->SignalDead(exitcode);
+        entry->instance->SignalDead(exitcode);
+        entry->instance->DetachRegistry();
+        entry->instance = nullptr;
     }
-    mutex_unlock(thread_dealloc_mutex);
+    shard->lock.Unlock();
 }
 
 static void RuntimeThreadExit(long exitcode)
 {
-    error_t ret;
-    link_p link;
+    ThreadRegistryShard * shard;
+    ThreadRegistryEntry * entry;
     uint32_t pid;
 
-    pid =  thread_geti();
+    pid   = thread_geti();
+    shard = ThreadRegistryShardOf(pid);
 
-    mutex_lock(thread_chain_mutex);
-    {
-        // ep hackery
-        ThreadExitNtfyEP(pid, exitcode);
+    // this runs for every task exit in the system; most were never ours, so don't touch the lock unless there's something to find
+    RCU::ReadLock();
+    entry = ThreadRegistryFind(shard, pid);
+    RCU::ReadUnlock();
 
-        // try notify othreadimpl that its controlling a dead handle, if not already nuked from a dumb pointer.
-        ThreadExitNtfyObject(pid, exitcode);
-    }
-    mutex_unlock(thread_chain_mutex);
+    if (!entry)
+        return;
+
+    // destructors may use thread locals themselves, so run them while we're still registered.
+    // entries are only ever unlinked and freed by their own task, so this one can't go away under us
+    ThreadLocalsExit(&entry->locals);
+
+    shard->lock.Lock();
+    entry = ThreadRegistryUnlink(shard, pid);
+    shard->lock.Unlock();
+
+    if (!entry)
+        return;
+
+    // exited on its own before the context switch hook got to it
+    if (_InterlockedExchange(&entry->killPending, 0))
+        ThreadRegistryRetireKill(shard);
+
+    // ep hackery
+    ThreadExitNtfyEP(entry, exitcode);
+
+    ThreadExitNtfyObject(shard, entry, exitcode);
+
+    RCU::DeferredCall(&entry->rcu, ThreadRegistryFree);
 }
 
 static void RuntimeThreadPostContextSwitch()
 {
-    error_t err;
-    volatile long * exitCode;
-    volatile long * exitSignal;
-
-    if (!closing_threads)
-        return;
+    ThreadRegistryShard * shard;
+    ThreadRegistryEntry * entry;
+    uint32_t pid;
+    long exitcode;
+    bool kill;
 
-    err = _thread_tls_get(TLS_TYPE_XGLOBAL, 1, NULL, (void **)&exitSignal);
-    if (err == kErrorBSTNodeNotFound)
+    // runs on every switch of every task in the system: a single shared read unless a kill is outstanding
+    if (!closing_threads.Read())
         return;
 
-    ASSERT(NO_ERROR(err), "Couldn't get task exit code TLS entry (error: " PRINTF_ERROR ")", err);
+    pid   = thread_geti();
+    shard = ThreadRegistryShardOf(pid);
 
-    if (!*exitSignal)
+    // a kill aimed at some other shard's task doesn't make us walk ours
+    if (!shard->kills)
         return;
 
-    *exitSignal = false;
+    kill = false;
 
-    err = _thread_tls_get(TLS_TYPE_XGLOBAL, 2, NULL, (void **)&exitCode);
-    ASSERT(NO_ERROR(err), "Couldn't get task exit code TLS entry (error: " PRINTF_ERROR ")", err);
+    RCU::ReadLock();
+    entry = ThreadRegistryFind(shard, pid);
+    if (entry && _InterlockedExchange(&entry->killPending, 0))
+    {
+        exitcode = entry->killCode;
+        kill     = true;
+    }
+    RCU::ReadUnlock();
 
-    _InterlockedDecrement(&closing_threads);
+    if (!kill)
+        return;
+
+    ThreadRegistryRetireKill(shard);
 
     // Stop linux whining 
     preempt_enable();
 
     // Night
-    do_exit((int32_t)*exitCode);
+    do_exit((int32_t)exitcode);
 }
 
-static void ThreadEPAllocateTLSEntries(OThreadImp * instance)
+// entries are only freed by their own task's exit, so the caller may keep using it after the read section
+static ThreadRegistryEntry * ThreadRegistryCurrent(uint32_t pid)
 {
-    error_t ret;
+    ThreadRegistryEntry * entry;
+
+    RCU::ReadLock();
+    entry = ThreadRegistryFind(ThreadRegistryShardOf(pid), pid);
+    RCU::ReadUnlock();
+
+    return entry;
+}
 
-    ret = _thread_tls_allocate(TLS_TYPE_XGLOBAL, 1, sizeof(long), NULL, (void **)instance->DeathSignal());
-    ASSERT(NO_ERROR(ret), "couldn't create thread death signal. error code: " PRINTF_ERROR, ret);
+void * ThreadRegistryGetLocals()
+{
+    ThreadRegistryEntry * entry;
 
-    ret = _thread_tls_allocate(TLS_TYPE_XGLOBAL, 2, sizeof(long), NULL, (void **)instance->DeathCode());
-    ASSERT(NO_ERROR(ret), "couldn't create thread death code. error code: " PRINTF_ERROR, ret);
+    entry = ThreadRegistryCurrent(thread_geti());
+    return entry ? entry->locals : nullptr;
 }
 
-static void ThreadEPHandleChains(uint32_t pid, OThreadImp * instance, CPU::Threading::OThreadEP_t ep)
+error_t ThreadRegistrySetLocals(void * locals)
 {
-    error_t ret;
-    OThreadImp ** handle;
-    CPU::Threading::OThreadEP_t * ep_tracker;
+    ThreadRegistryEntry * entry;
+    uint32_t pid;
 
-    mutex_lock(thread_chain_mutex);
+    pid   = thread_geti();
+    entry = ThreadRegistryCurrent(pid);
 
-    ret = chain_allocate_link(thread_handle_chain, pid, sizeof(size_t), nullptr, nullptr, (void **)&handle);
-    ASSERT(NO_ERROR(ret), "couldn't create thread link. error code: " PRINTF_ERROR, ret);
-    *handle = instance;
+    if (entry)
+    {
+        entry->locals = locals;
+        return kStatusOkay;
+    }
 
-    ret = chain_allocate_link(thread_ep_chain, pid, sizeof(size_t), nullptr, nullptr, (void **)&ep_tracker);
-    ASSERT(NO_ERROR(ret), "couldn't create thread link. error code: " PRINTF_ERROR, ret);
-    *ep_tracker = ep;
+    // not one of ours; give it an entry anyway so its exit still finds the block
+    entry = (ThreadRegistryEntry *)zalloc(sizeof(ThreadRegistryEntry));
+    if (!entry)
+        return kErrorOutOfMemory;
 
-    mutex_unlock(thread_chain_mutex);
+    entry->pid    = pid;
+    entry->locals = locals;
+
+    ThreadRegistryInsert(entry);
+    return kStatusOkay;
 }
 
-static void ThreadEPInitExitHandler()
+static void ThreadEPRegister(uint32_t pid, OThreadImp * instance, CPU::Threading::OThreadEP_t ep)
 {
-    thread_exit_cb_t * cb_arr;
-    int cb_cnt;
-    int i = 0;
+    ThreadRegistryEntry * entry;
 
-    threading_get_exit_callbacks(&cb_arr, &cb_cnt);
-    
-    while (cb_arr[i])
-    {
-        i++;
-        if (i >= cb_cnt)
-        {
-            panic("couldn't install thread exit callback for libos runtime");
-        }
-    }
+    entry = (ThreadRegistryEntry *)zalloc(sizeof(ThreadRegistryEntry));
+    ASSERT(entry, "couldn't allocate thread registry entry");
 
-    cb_arr[i] = RuntimeThreadExit;
+    entry->pid        = pid;
+    entry->entrypoint = ep;
+    entry->instance   = instance;
+
+    // nobody else knows about instance yet, so no lock needed for the back pointer
+    instance->AttachRegistry(entry);
+    ThreadRegistryInsert(entry);
 }
 
 static void ThreadEPAddContextSwitchHandler()
@@ -396,6 +540,22 @@ static void ThreadEPAddContextSwitchHandler()
     thread_post_context_switch_hook(RuntimeThreadPostContextSwitch);
 }
 
+void InitThreading()
+{
+    error_t err;
+
+    // batch of one: the post context switch gate must never miss a pending kill, so every update goes straight to the shared total
+    err = closing_threads.Init(1);
+    ASSERT(NO_ERROR(err), "couldn't initialize closing thread counter");
+
+    // thread_registry is zero initialized: unlocked, empty shards
+
+    err = ThreadExitSubscribe(RuntimeThreadExit);
+    ASSERT(NO_ERROR(err), "couldn't subscribe to thread exits (error: " PRINTF_ERROR ")", err);
+
+    ThreadEPAddContextSwitchHandler();
+}
+
 static int RuntimeThreadEP(void * data)
 {
     OThreadImp * instance;
@@ -406,8 +566,6 @@ static int RuntimeThreadEP(void * data)
     const char * th_name;
     uint32_t pid;
     int exitcode;
-    uint32_t idc;
-    uint32_t idfc;
 
     task    = OSThread;
     pid     = thread_geti();
@@ -418,17 +576,11 @@ static int RuntimeThreadEP(void * data)
     ep_data = priv->data;
     th_name = priv->name;
 
-    free((void *)priv);
-
     // allocate thread
     instance = new OThreadImp(task, pid, th_name, ep_data);
     ASSERT(instance, "couldn't allocate OThread instance");
 
-    ThreadEPHandleChains(pid, instance, ep_stub);
-    ThreadEPAllocateTLSEntries(instance);
-    ThreadEPInitExitHandler();
-
-    ThreadEPAddContextSwitchHandler();
+    ThreadEPRegister(pid, instance, ep_stub);
     
     // nasty ass hack
     //HackProcessesOThreadHook();
@@ -445,8 +597,9 @@ static int RuntimeThreadEP(void * data)
         ep_stub(&msg);
     }
 
-    sync_thread_create.instance = instance;
-    sync_thread_create.semaphore->Trigger(1, idc, idfc);
+    // hand the instance back; priv may be gone the moment created is set
+    priv->instance = instance;
+    priv->created.Set();
 
     // ntfy thread start
     {
@@ -463,32 +616,66 @@ static int RuntimeThreadEP(void * data)
     return exitcode;
 }
 
-error_t CPU::Threading::SpawnOThread(const OOutlivableRef<CPU::Threading::OThread> & thread, CPU::Threading::OThreadEP_t entrypoint, const char * name, void * data)
+static error_t ThreadSpawnBegin(ThreadPrivData_p priv, CPU::Threading::OThreadEP_t entrypoint, const char * name, void * data)
 {
-    error_t err;
     task_k task;
-    ThreadPrivData_p priv;
-    
-    priv = (ThreadPrivData_p)malloc(sizeof(ThreadPrivData_t));
-    ASSERT(priv, "couldn't allocate temp thread storage");
 
+    new (&priv->created) Synchronization::Completion();
     priv->entrypoint = entrypoint;
     priv->data       = data;
     priv->name       = name;
+    priv->instance   = nullptr;
+
+    return thread_create(&task, RuntimeThreadEP, priv, name, true);
+}
 
-    mutex_lock(sync_thread_create.mutex);
-    sync_thread_create.instance = nullptr;
+static OThreadImp * ThreadSpawnFinish(ThreadPrivData_p priv)
+{
+    priv->created.Wait();
+    return priv->instance;
+}
 
-    err = thread_create(&task, RuntimeThreadEP, priv, name, true);
+error_t CPU::Threading::SpawnOThread(const OOutlivableRef<CPU::Threading::OThread> & thread, CPU::Threading::OThreadEP_t entrypoint, const char * name, void * data)
+{
+    error_t err;
+    ThreadPrivData_t priv;
+
+    err = ThreadSpawnBegin(&priv, entrypoint, name, data);
     if (ERROR(err))
-    {
-        mutex_unlock(sync_thread_create.mutex);
         return err;
-    }
-    
-    sync_thread_create.semaphore->Wait();
 
-    thread.PassOwnership(sync_thread_create.instance);
-    mutex_unlock(sync_thread_create.mutex);
+    thread.PassOwnership(ThreadSpawnFinish(&priv));
     return kStatusOkay;
 }
+
+error_t CPU::Threading::SpawnOThreads(CPU::Threading::OThread ** threads, size_t count, CPU::Threading::OThreadEP_t entrypoint, const char * name, void ** data)
+{
+    error_t err;
+    size_t started;
+    ThreadPrivData_p privs;
+
+    if (!threads || !entrypoint)
+        return kErrorIllegalBadArgument;
+
+    privs = (ThreadPrivData_p)zalloc(sizeof(ThreadPrivData_t) * count);
+    if (!privs && count)
+        return kErrorOutOfMemory;
+
+    err = kStatusOkay;
+
+    // kick everything off before waiting on anyone
+    for (started = 0; started < count; started++)
+    {
+        err = ThreadSpawnBegin(&privs[started], entrypoint, name, data ? data[started] : nullptr);
+        if (ERROR(err))
+            break;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        threads[i] = i < started ? ThreadSpawnFinish(&privs[i]) : nullptr;
+
+    if (privs)
+        free(privs);
+
+    return err;
+}
@@ -6,6 +6,9 @@
 #pragma once
 #include <Core/CPU/OThread.hpp>
 #include <Core/Synchronization/OSpinlock.hpp>
+#include "../Synchronization/WaitList.hpp"
+
+struct ThreadRegistryEntry;
 
 class OThreadImp : public CPU::Threading::OThread
 {
@@ -30,12 +33,21 @@ public:
     error_t IsFloatingHandle(bool &)                  override;      
     error_t GetOSHandle(void *& handle)               override;
 
+    error_t GetStats(CPU::Threading::ThreadStats_t & stats) override;
+
     void SignalDead(long exitcode = -420);
 
+    // under the registry shard lock (or before the instance is published)
+    void AttachRegistry(ThreadRegistryEntry * entry) { _registry = entry;   }
+    void DetachRegistry()                            { _registry = nullptr; }
+
     void * GetData() override;
 
-    long ** DeathSignal();
-    long ** DeathCode();
+    bool WaitableIsSignaled()                         override; // thread has exited
+    bool WaitableTryAcquire()                         override;
+    void WaitableRelease()                            override;
+    void WaitableAddObserver(Synchronization::WaitableObserver * observer)    override;
+    void WaitableRemoveObserver(Synchronization::WaitableObserver * observer) override;
 
 protected:
     void InvalidateImp()                              override;
@@ -48,14 +60,18 @@ protected:
     bool _try_kill;
 
     Synchronization::Spinlock _task_holder;
+    WaitListHead _observers;    // protected by _task_holder
+    ThreadRegistryEntry * _registry;
 
     void Lock();
     void Unlock();
-    
-    long * _death_code;
-    long * _death_signal;
 };
 
 extern void InitThreading();
 
+// the calling task's thread local block (see OThreadLocal.cpp)
+extern void * ThreadRegistryGetLocals();
+extern error_t ThreadRegistrySetLocals(void * locals);
+
 LIBLINUX_SYM error_t CPU::Threading::SpawnOThread(const OOutlivableRef<CPU::Threading::OThread> & thread, CPU::Threading::OThreadEP_t entrypoint, const char * name, void * data);
+LIBLINUX_SYM error_t CPU::Threading::SpawnOThreads(CPU::Threading::OThread ** threads, size_t count, CPU::Threading::OThreadEP_t entrypoint, const char * name, void ** data);
@@ -0,0 +1,195 @@
+/*
+    Purpose: single exit callback multicasting every task exit to libos subscribers
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "OThreadExit.hpp"
+#include <Core/Synchronization/OMutex.hpp>
+#include "../../Utils/RCU.hpp"
+
+// immutable once published; writers swap in a modified copy
+struct ThreadExitSubscribers
+{
+    RCU::Head rcu;                  // must remain first
+    volatile long refs;             // one for being published, plus one per exit still calling into it
+    uint32_t count;
+    ThreadExitNtfy_f callbacks[1];  // count entries
+};
+
+static Synchronization::OMutex * thread_exit_mutex;                 // writers
+static ThreadExitSubscribers * volatile thread_exit_subscribers;    // null when nobody is subscribed
+
+static ThreadExitSubscribers * ThreadExitAllocate(uint32_t count)
+{
+    ThreadExitSubscribers * subscribers;
+
+    subscribers = (ThreadExitSubscribers *)zalloc(sizeof(ThreadExitSubscribers) + (sizeof(ThreadExitNtfy_f) * MAX(count, 1)));
+    if (!subscribers)
+        return nullptr;
+
+    subscribers->refs  = 1;
+    subscribers->count = count;
+    return subscribers;
+}
+
+static void ThreadExitRelease(ThreadExitSubscribers * subscribers)
+{
+    if (_InterlockedDecrement(&subscribers->refs) == 0)
+        free(subscribers);
+}
+
+static void ThreadExitRetire(RCU::Head * head)
+{
+    ThreadExitRelease(reinterpret_cast<ThreadExitSubscribers *>(head));
+}
+
+// under thread_exit_mutex
+static void ThreadExitPublish(ThreadExitSubscribers * subscribers)
+{
+    ThreadExitSubscribers * old;
+
+    old = thread_exit_subscribers;
+    RCU::AssignPointer(thread_exit_subscribers, subscribers);
+
+    // every reader that could still find old has pinned it by the end of the grace period
+    if (old)
+        RCU::DeferredCall(&old->rcu, ThreadExitRetire);
+}
+
+error_t ThreadExitSubscribe(ThreadExitNtfy_f callback)
+{
+    ThreadExitSubscribers * old;
+    ThreadExitSubscribers * subscribers;
+    uint32_t count;
+
+    if (!callback)
+        return kErrorIllegalBadArgument;
+
+    thread_exit_mutex->Lock();
+
+    old   = thread_exit_subscribers;
+    count = old ? old->count : 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (old->callbacks[i] == callback)
+        {
+            thread_exit_mutex->Unlock();
+            return kStatusLinkPresent;
+        }
+    }
+
+    subscribers = ThreadExitAllocate(count + 1);
+    if (!subscribers)
+    {
+        thread_exit_mutex->Unlock();
+        return kErrorOutOfMemory;
+    }
+
+    if (count)
+        memcpy(subscribers->callbacks, old->callbacks, sizeof(ThreadExitNtfy_f) * count);
+
+    subscribers->callbacks[count] = callback;
+
+    ThreadExitPublish(subscribers);
+    thread_exit_mutex->Unlock();
+    return kStatusOkay;
+}
+
+error_t ThreadExitUnsubscribe(ThreadExitNtfy_f callback)
+{
+    ThreadExitSubscribers * old;
+    ThreadExitSubscribers * subscribers;
+    uint32_t index;
+    uint32_t count;
+
+    thread_exit_mutex->Lock();
+
+    old   = thread_exit_subscribers;
+    count = old ? old->count : 0;
+
+    for (index = 0; index < count; index++)
+    {
+        if (old->callbacks[index] == callback)
+            break;
+    }
+
+    if (index == count)
+    {
+        thread_exit_mutex->Unlock();
+        return kErrorCallbackNotFound;
+    }
+
+    subscribers = nullptr;
+
+    if (count > 1)
+    {
+        subscribers = ThreadExitAllocate(count - 1);
+        if (!subscribers)
+        {
+            thread_exit_mutex->Unlock();
+            return kErrorOutOfMemory;
+        }
+
+        memcpy(subscribers->callbacks, old->callbacks, sizeof(ThreadExitNtfy_f) * index);
+        memcpy(subscribers->callbacks + index, old->callbacks + index + 1, sizeof(ThreadExitNtfy_f) * (count - index - 1));
+    }
+
+    ThreadExitPublish(subscribers);
+    thread_exit_mutex->Unlock();
+    return kStatusOkay;
+}
+
+static void ThreadExitDispatch(long exitcode)
+{
+    ThreadExitSubscribers * subscribers;
+
+    // pin the snapshot rather than holding the read section; subscribers are allowed to sleep
+    RCU::ReadLock();
+    subscribers = RCU::Dereference(thread_exit_subscribers);
+    if (subscribers)
+        _InterlockedIncrement(&subscribers->refs);
+    RCU::ReadUnlock();
+
+    if (!subscribers)
+        return;
+
+    for (uint32_t i = 0; i < subscribers->count; i++)
+        subscribers->callbacks[i](exitcode);
+
+    ThreadExitRelease(subscribers);
+}
+
+static void ThreadExitInstall()
+{
+    thread_exit_cb_t * cb_arr;
+    int cb_cnt;
+
+    threading_get_exit_callbacks(&cb_arr, &cb_cnt);
+
+    for (int i = 0; i < cb_cnt; i++)
+    {
+        if (cb_arr[i] == ThreadExitDispatch)
+            return;
+
+        if (!cb_arr[i])
+        {
+            cb_arr[i] = ThreadExitDispatch;
+            return;
+        }
+    }
+
+    panic("couldn't install thread exit callback for libos");
+}
+
+void InitThreadExit()
+{
+    error_t err;
+
+    err = Synchronization::CreateMutex(Synchronization::kMutexSleeping, thread_exit_mutex);
+    ASSERT(NO_ERROR(err), "couldn't create thread exit mutex");
+
+    // the only slot libos ever takes in the kernel's table, no matter how many threads or subscribers come and go
+    ThreadExitInstall();
+}
@@ -0,0 +1,14 @@
+/*
+    Purpose: single exit callback multicasting every task exit to libos subscribers
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+typedef void(*ThreadExitNtfy_f)(long exitcode);
+
+// Subscribers run in the exiting task's context, for every task exit in the system, and may sleep.
+extern error_t ThreadExitSubscribe(ThreadExitNtfy_f callback);     // kStatusLinkPresent if already subscribed
+extern error_t ThreadExitUnsubscribe(ThreadExitNtfy_f callback);   // exits already under way may still call it
+
+extern void InitThreadExit();
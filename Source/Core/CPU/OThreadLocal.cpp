@@ -0,0 +1,120 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "OThreadLocal.hpp"
+#include "OThread.hpp"
+
+#define THREAD_LOCAL_EXIT_PASSES 4  // destructors that set values again get this many rounds (PTHREAD_DESTRUCTOR_ITERATIONS)
+
+// one per task that has set anything; hung off its thread registry entry and only ever touched by that task
+struct ThreadLocalBlock
+{
+    void * values[THREAD_LOCAL_SLOTS];
+};
+
+static volatile long thread_local_slots;
+static CPU::Threading::ThreadLocalDtor_f thread_local_dtors[THREAD_LOCAL_SLOTS];
+
+error_t CPU::Threading::AllocateThreadLocal(CPU::Threading::ThreadLocalSlot_t & slot, CPU::Threading::ThreadLocalDtor_f dtor)
+{
+    long index;
+
+    do
+    {
+        index = thread_local_slots;
+
+        if (index >= THREAD_LOCAL_SLOTS)
+            return kErrorOutOfUIDs;
+
+    } while (_InterlockedCompareExchange(&thread_local_slots, index + 1, index) != index);
+
+    // nobody can hold a value for this slot until we've returned it
+    thread_local_dtors[index] = dtor;
+    slot = index;
+    return kStatusOkay;
+}
+
+error_t CPU::Threading::GetThreadLocal(CPU::Threading::ThreadLocalSlot_t slot, void *& value)
+{
+    ThreadLocalBlock * block;
+
+    if (slot >= (ThreadLocalSlot_t)thread_local_slots)
+        return kErrorIllegalBadArgument;
+
+    block = (ThreadLocalBlock *)ThreadRegistryGetLocals();
+    value = block ? block->values[slot] : nullptr;
+    return kStatusOkay;
+}
+
+error_t CPU::Threading::SetThreadLocal(CPU::Threading::ThreadLocalSlot_t slot, void * value)
+{
+    error_t err;
+    ThreadLocalBlock * block;
+
+    if (slot >= (ThreadLocalSlot_t)thread_local_slots)
+        return kErrorIllegalBadArgument;
+
+    block = (ThreadLocalBlock *)ThreadRegistryGetLocals();
+
+    if (!block)
+    {
+        if (!value)
+            return kStatusOkay;
+
+        block = (ThreadLocalBlock *)zalloc(sizeof(ThreadLocalBlock));
+        if (!block)
+            return kErrorOutOfMemory;
+
+        err = ThreadRegistrySetLocals(block);
+        if (ERROR(err))
+        {
+            free(block);
+            return err;
+        }
+    }
+
+    block->values[slot] = value;
+    return kStatusOkay;
+}
+
+void ThreadLocalsExit(void ** locals)
+{
+    ThreadLocalBlock * block;
+    long slots;
+    bool found;
+    void * value;
+
+    block = (ThreadLocalBlock *)*locals;
+    if (!block)
+        return;
+
+    slots = MIN(thread_local_slots, THREAD_LOCAL_SLOTS);
+
+    // leave the block attached: destructors may still read other slots, or set new values
+    for (int pass = 0; pass < THREAD_LOCAL_EXIT_PASSES; pass++)
+    {
+        found = false;
+
+        for (long i = 0; i < slots; i++)
+        {
+            value = block->values[i];
+            if (!value)
+                continue;
+
+            block->values[i] = nullptr;
+            found = true;
+
+            if (thread_local_dtors[i])
+                thread_local_dtors[i](value);
+        }
+
+        if (!found)
+            break;
+    }
+
+    *locals = nullptr;
+    free(block);
+}
@@ -0,0 +1,14 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/CPU/OThreadLocal.hpp>
+
+// runs the destructors of (and frees) the exiting task's block; *locals is the registry entry's pointer to it
+extern void ThreadLocalsExit(void ** locals);
+
+LIBLINUX_SYM error_t CPU::Threading::AllocateThreadLocal(CPU::Threading::ThreadLocalSlot_t & slot, CPU::Threading::ThreadLocalDtor_f dtor);
+LIBLINUX_SYM error_t CPU::Threading::GetThreadLocal(CPU::Threading::ThreadLocalSlot_t slot, void *& value);
+LIBLINUX_SYM error_t CPU::Threading::SetThreadLocal(CPU::Threading::ThreadLocalSlot_t slot, void * value);
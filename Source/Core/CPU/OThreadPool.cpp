@@ -0,0 +1,543 @@
+/*
+    Purpose: Work-stealing thread pool - one worker per CPU, Chase-Lev deques plus a shared injection queue
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "OThreadPool.hpp"
+
+#include <Core/CPU/OThread.hpp>
+#include <Core/CPU/OPerCpuCounter.hpp>
+#include <Core/CPU/OMemoryCoherency.hpp>
+#include "../Synchronization/LinuxSleeping.hpp"
+#include "../Synchronization/OWaitable.hpp"
+
+#define POOL_DEQUE_SIZE   256  // power of two; a full deque spills into the injection queue
+#define POOL_DEQUE_MASK   (POOL_DEQUE_SIZE - 1)
+#define POOL_STEAL_ROUNDS 2
+
+struct PoolItem
+{
+    WaitListNode node;         // injection queue and batch linkage; must remain first
+    CPU::Threading::PoolTask_f callback;
+    void * context;
+    PoolCompletionState * completion;
+};
+
+// top is hammered by thieves, bottom only written by the owner - keep them apart
+struct PoolDeque
+{
+    __declspec(align(SPINLOCK_CACHE_LINE)) volatile int64_t top;
+    __declspec(align(SPINLOCK_CACHE_LINE)) volatile int64_t bottom;
+    PoolItem * volatile items[POOL_DEQUE_SIZE];
+};
+
+struct __declspec(align(SPINLOCK_CACHE_LINE)) PoolWorker
+{
+    PoolDeque deque;
+    task_k task;
+    CPU::Threading::OThread * thread;
+    uint32_t seed;  // victim selection
+};
+
+static PoolWorker * pool_workers;
+static void * pool_allocation;
+static uint32_t pool_count;
+
+static Synchronization::Spinlock pool_inject_lock;
+static WaitListHead pool_inject;
+
+static Synchronization::Spinlock pool_idle_lock;
+static WaitListHead pool_idle;
+static volatile long pool_idle_count;
+static volatile long pool_queued;   // submitted but not yet picked up; bumped before publishing, so never under counts
+
+static bool PoolDequePush(PoolDeque * deque, PoolItem * item)
+{
+    int64_t bottom;
+    int64_t top;
+
+    bottom = deque->bottom;
+    top    = deque->top;
+
+    if (bottom - top >= POOL_DEQUE_SIZE)
+        return false;
+
+    deque->items[bottom & POOL_DEQUE_MASK] = item;
+
+    // x86 doesn't reorder stores; the compiler just needs to keep the item ahead of the new bottom
+    _ReadWriteBarrier();
+    deque->bottom = bottom + 1;
+    return true;
+}
+
+static PoolItem * PoolDequePop(PoolDeque * deque)
+{
+    int64_t bottom;
+    int64_t top;
+    PoolItem * item;
+
+    bottom = deque->bottom - 1;
+
+    // store-load fence: the reservation of bottom must be visible before we read top
+    _InterlockedExchange64(&deque->bottom, bottom);
+    top = deque->top;
+
+    if (top > bottom)
+    {
+        deque->bottom = bottom + 1;
+        return nullptr;
+    }
+
+    item = deque->items[bottom & POOL_DEQUE_MASK];
+
+    if (top != bottom)
+        return item;
+
+    // last item - race the thieves for it
+    if (_InterlockedCompareExchange64(&deque->top, top + 1, top) != top)
+        item = nullptr;
+
+    deque->bottom = bottom + 1;
+    return item;
+}
+
+static PoolItem * PoolDequeSteal(PoolDeque * deque)
+{
+    int64_t bottom;
+    int64_t top;
+    PoolItem * item;
+
+    top = deque->top;
+    _ReadWriteBarrier();
+    bottom = deque->bottom;
+
+    if (top >= bottom)
+        return nullptr;
+
+    // the owner can't reuse this slot until top moves past it
+    item = deque->items[top & POOL_DEQUE_MASK];
+
+    if (_InterlockedCompareExchange64(&deque->top, top + 1, top) != top)
+        return nullptr;
+
+    return item;
+}
+
+static PoolWorker * PoolCurrentWorker()
+{
+    task_k self;
+
+    self = OSThread;
+
+    for (uint32_t i = 0; i < pool_count; i++)
+    {
+        if (pool_workers[i].task == self)
+            return &pool_workers[i];
+    }
+
+    return nullptr;
+}
+
+static void PoolCompletionRelease(PoolCompletionState * state)
+{
+    if (_InterlockedDecrement(&state->refs) == 0)
+        free(state);
+}
+
+static void PoolCompletionTaskDone(PoolCompletionState * state)
+{
+    if (_InterlockedDecrement(&state->pending) != 0)
+        return;
+
+    state->done.Set();
+
+    state->lock.Lock();
+    WaitableNotifyObservers(&state->observers);
+    state->lock.Unlock();
+
+    PoolCompletionRelease(state);
+}
+
+static void PoolWake(uint32_t count)
+{
+    LinuxWakeQueue wake;
+    size_t claimed;
+
+    // pairs with the idle path: it bumps pool_idle_count before its final look at pool_queued
+    CPU::Memory::ReadWriteBarrier();
+
+    if (!pool_idle_count)
+        return;
+
+    LinuxWakeQueueInit(&wake);
+
+    pool_idle_lock.Lock();
+    for (claimed = 0; (claimed < count) && !WaitListIsEmpty(&pool_idle); claimed++)
+        LinuxWakeQueueClaim(&wake, &pool_idle, WAIT_LIST_ENTRY(pool_idle.head, LinuxWaiter));
+    pool_idle_lock.Unlock();
+
+    LinuxWakeQueueWake(&wake);
+}
+
+static void PoolPublish(PoolWorker * self, PoolItem * item)
+{
+    if (self && PoolDequePush(&self->deque, item))
+        return;
+
+    pool_inject_lock.Lock();
+    WaitListAppend(&pool_inject, &item->node);
+    pool_inject_lock.Unlock();
+}
+
+static PoolItem * PoolFindWork(PoolWorker * self)
+{
+    PoolItem * item;
+    WaitListNode * node;
+    uint32_t start;
+
+    if ((item = PoolDequePop(&self->deque)))
+        return item;
+
+    if (!WaitListIsEmpty(&pool_inject))
+    {
+        pool_inject_lock.Lock();
+        node = WaitListPopFront(&pool_inject);
+        pool_inject_lock.Unlock();
+
+        if (node)
+            return WAIT_LIST_ENTRY(node, PoolItem);
+    }
+
+    for (uint32_t round = 0; round < POOL_STEAL_ROUNDS; round++)
+    {
+        // xorshift; start somewhere different each time so thieves don't pile onto the same victim
+        self->seed ^= self->seed << 13;
+        self->seed ^= self->seed >> 17;
+        self->seed ^= self->seed << 5;
+        start = self->seed % pool_count;
+
+        for (uint32_t i = 0; i < pool_count; i++)
+        {
+            PoolWorker * victim;
+
+            victim = &pool_workers[(start + i) % pool_count];
+            if (victim == self)
+                continue;
+
+            if ((item = PoolDequeSteal(&victim->deque)))
+                return item;
+        }
+    }
+
+    return nullptr;
+}
+
+static void PoolRun(PoolItem * item)
+{
+    _InterlockedDecrement(&pool_queued);
+
+    item->callback(item->context);
+
+    if (item->completion)
+        PoolCompletionTaskDone(item->completion);
+
+    free(item);
+}
+
+static void PoolIdle()
+{
+    LinuxWaiter entry;
+
+    pool_idle_lock.Lock();
+
+    // announce ourselves before the final check; submitters publish before looking for idle workers
+    _InterlockedIncrement(&pool_idle_count);
+
+    if (pool_queued)
+    {
+        _InterlockedDecrement(&pool_idle_count);
+        pool_idle_lock.Unlock();
+        return;
+    }
+
+    LinuxWaiterInit(&entry);
+    LinuxWaiterEnqueue(&pool_idle, &entry);
+    pool_idle_lock.Unlock();
+
+    LinuxSleep(-1, LinuxWaiterIsSignaled, &entry);
+
+    pool_idle_lock.Lock();
+    LinuxWaiterFinish(&pool_idle, &entry);
+    _InterlockedDecrement(&pool_idle_count);
+    pool_idle_lock.Unlock();
+}
+
+static void PoolWorkerEP(CPU::Threading::ThreadMsg_ref msg)
+{
+    PoolWorker * self;
+    PoolItem * item;
+
+    if (msg->type == CPU::Threading::kMsgThreadCreate)
+    {
+        // before SpawnOThread returns, so submissions from this thread find their deque straight away
+        reinterpret_cast<PoolWorker *>(msg->create.data)->task = OSThread;
+        return;
+    }
+
+    if (msg->type != CPU::Threading::kMsgThreadStart)
+        return;
+
+    self = reinterpret_cast<PoolWorker *>(msg->start.data);
+
+    while (true)
+    {
+        if ((item = PoolFindWork(self)))
+        {
+            PoolRun(item);
+            continue;
+        }
+
+        PoolIdle();
+    }
+}
+
+static error_t PoolSubmit(const CPU::Threading::PoolTask_t * tasks, size_t count, PoolCompletionState * completion)
+{
+    WaitListHead batch;
+    WaitListNode * node;
+    PoolWorker * self;
+
+    WaitListInit(&batch);
+
+    // all or nothing
+    for (size_t i = 0; i < count; i++)
+    {
+        PoolItem * item;
+
+        item = reinterpret_cast<PoolItem *>(zalloc(sizeof(PoolItem)));
+        if (!item)
+        {
+            while ((node = WaitListPopFront(&batch)))
+                free(WAIT_LIST_ENTRY(node, PoolItem));
+            return kErrorOutOfMemory;
+        }
+
+        item->callback   = tasks[i].callback;
+        item->context    = tasks[i].context;
+        item->completion = completion;
+        WaitListAppend(&batch, &item->node);
+    }
+
+    self = PoolCurrentWorker();
+
+    _InterlockedExchangeAdd(&pool_queued, long(count));
+
+    while ((node = WaitListPopFront(&batch)))
+        PoolPublish(self, WAIT_LIST_ENTRY(node, PoolItem));
+
+    PoolWake(uint32_t(count));
+    return kStatusOkay;
+}
+
+static error_t PoolCheckTasks(const CPU::Threading::PoolTask_t * tasks, size_t count)
+{
+    if (!pool_count)
+        return kErrorInternalError;
+
+    if (count > INT32_MAX)
+        return kErrorIllegalSize;
+
+    if (count && !tasks)
+        return kErrorIllegalBadArgument;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!tasks[i].callback)
+            return kErrorIllegalBadArgument;
+    }
+
+    return kStatusOkay;
+}
+
+error_t PoolSubmitBatch(const CPU::Threading::PoolTask_t * tasks, size_t count)
+{
+    error_t err;
+
+    err = PoolCheckTasks(tasks, count);
+    if (ERROR(err))
+        return err;
+
+    return PoolSubmit(tasks, count, nullptr);
+}
+
+error_t CPU::Threading::SubmitPoolTask(CPU::Threading::PoolTask_f callback, void * context)
+{
+    error_t err;
+    CPU::Threading::PoolTask_t task;
+
+    task.callback = callback;
+    task.context  = context;
+
+    err = PoolCheckTasks(&task, 1);
+    if (ERROR(err))
+        return err;
+
+    return PoolSubmit(&task, 1, nullptr);
+}
+
+error_t CPU::Threading::SubmitPoolTask(CPU::Threading::PoolTask_f callback, void * context, const OOutlivableRef<CPU::Threading::OPoolCompletion> & completion)
+{
+    CPU::Threading::PoolTask_t task;
+
+    task.callback = callback;
+    task.context  = context;
+
+    return SubmitPoolTasks(&task, 1, completion);
+}
+
+error_t CPU::Threading::SubmitPoolTasks(const CPU::Threading::PoolTask_t * tasks, size_t count, const OOutlivableRef<CPU::Threading::OPoolCompletion> & completion)
+{
+    error_t err;
+    PoolCompletionState * state;
+    OPoolCompletionImpl * handle;
+
+    err = PoolCheckTasks(tasks, count);
+    if (ERROR(err))
+        return err;
+
+    state = reinterpret_cast<PoolCompletionState *>(zalloc(sizeof(PoolCompletionState)));
+    if (!state)
+        return kErrorOutOfMemory;
+
+    new (&state->done) Synchronization::Completion();
+    new (&state->lock) Synchronization::Spinlock();
+    WaitListInit(&state->observers);
+
+    state->pending = long(count);
+    state->refs    = count ? 2 : 1; // the handle, plus the tasks as a whole
+
+    if (!count)
+        state->done.Set();
+
+    handle = new OPoolCompletionImpl(state);
+    if (!handle)
+    {
+        free(state);
+        return kErrorOutOfMemory;
+    }
+
+    err = PoolSubmit(tasks, count, state);
+    if (ERROR(err))
+    {
+        state->refs = 1;
+        handle->Destroy();
+        return err;
+    }
+
+    completion.PassOwnership(handle);
+    return kStatusOkay;
+}
+
+uint32_t CPU::Threading::GetPoolWorkers()
+{
+    return pool_count;
+}
+
+OPoolCompletionImpl::OPoolCompletionImpl(PoolCompletionState * state)
+{
+    _state = state;
+}
+
+error_t OPoolCompletionImpl::Wait(uint32_t ms)
+{
+    CHK_DEAD;
+    return WaitUntil(LinuxSleepDeadlineFromMS(ms));
+}
+
+error_t OPoolCompletionImpl::WaitUntil(uint64_t deadline)
+{
+    CHK_DEAD;
+    return _state->done.Wait(deadline);
+}
+
+error_t OPoolCompletionImpl::GetPending(uint32_t & tasks)
+{
+    CHK_DEAD;
+    tasks = uint32_t(_state->pending);
+    return kStatusOkay;
+}
+
+bool OPoolCompletionImpl::WaitableIsSignaled()
+{
+    return _state->done.IsSet();
+}
+
+bool OPoolCompletionImpl::WaitableTryAcquire()
+{
+    return WaitableIsSignaled();
+}
+
+void OPoolCompletionImpl::WaitableRelease()
+{
+}
+
+void OPoolCompletionImpl::WaitableAddObserver(Synchronization::WaitableObserver * observer)
+{
+    _state->lock.Lock();
+    WaitListAppend(&_state->observers, &observer->node);
+    _state->lock.Unlock();
+}
+
+void OPoolCompletionImpl::WaitableRemoveObserver(Synchronization::WaitableObserver * observer)
+{
+    _state->lock.Lock();
+    WaitListRemove(&_state->observers, &observer->node);
+    _state->lock.Unlock();
+}
+
+void OPoolCompletionImpl::InvalidateImp()
+{
+    ASSERT(WaitListIsEmpty(&_state->observers), "Destroyed pool completion with WaitMultiple observers");
+    PoolCompletionRelease(_state);
+}
+
+void InitThreadPool()
+{
+    error_t err;
+    uint32_t count;
+    CPU::Threading::OThread ** threads;
+    void ** data;
+
+    count = CPU::GetPossibleCPUs();
+
+    // over-allocate to line up the first worker
+    pool_allocation = zalloc(sizeof(PoolWorker) * (count + 1));
+    ASSERT(pool_allocation, "couldn't allocate thread pool workers");
+
+    pool_workers = reinterpret_cast<PoolWorker *>((size_t(pool_allocation) + SPINLOCK_CACHE_LINE - 1) & ~size_t(SPINLOCK_CACHE_LINE - 1));
+
+    WaitListInit(&pool_inject);
+    WaitListInit(&pool_idle);
+
+    for (uint32_t i = 0; i < count; i++)
+        pool_workers[i].seed = 0x9E3779B9u * (i + 1);
+
+    pool_count = count;
+
+    threads = reinterpret_cast<CPU::Threading::OThread **>(zalloc(sizeof(CPU::Threading::OThread *) * count));
+    data    = reinterpret_cast<void **>(zalloc(sizeof(void *) * count));
+    ASSERT(threads && data, "couldn't allocate thread pool spawn arguments");
+
+    for (uint32_t i = 0; i < count; i++)
+        data[i] = &pool_workers[i];
+
+    err = CPU::Threading::SpawnOThreads(threads, count, PoolWorkerEP, "libos_pool", data);
+    ASSERT(NO_ERROR(err), "couldn't spawn thread pool workers: " PRINTF_ERROR, err);
+
+    for (uint32_t i = 0; i < count; i++)
+        pool_workers[i].thread = threads[i];
+
+    free(threads);
+    free(data);
+}
@@ -0,0 +1,52 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/CPU/OThreadPool.hpp>
+#include <Core/Synchronization/OSpinlock.hpp>
+#include <Core/Synchronization/OWaitOnAddress.hpp>
+#include "../Synchronization/WaitList.hpp"
+
+// shared between the handle and the in-flight tasks; freed by whichever lets go last
+struct PoolCompletionState
+{
+    volatile long pending;
+    volatile long refs;
+    Synchronization::Completion done;
+    Synchronization::Spinlock lock;
+    WaitListHead observers;     // protected by lock
+};
+
+class OPoolCompletionImpl : public CPU::Threading::OPoolCompletion
+{
+public:
+    OPoolCompletionImpl(PoolCompletionState * state);
+
+    error_t Wait(uint32_t ms)                                                    override;
+    error_t WaitUntil(uint64_t deadline)                                         override;
+    error_t GetPending(uint32_t & tasks)                                         override;
+
+    bool WaitableIsSignaled()                                                    override; // every task has run
+    bool WaitableTryAcquire()                                                    override;
+    void WaitableRelease()                                                       override;
+    void WaitableAddObserver(Synchronization::WaitableObserver * observer)       override;
+    void WaitableRemoveObserver(Synchronization::WaitableObserver * observer)    override;
+
+protected:
+    void InvalidateImp()                                                         override;
+
+private:
+    PoolCompletionState * _state;
+};
+
+extern void InitThreadPool();
+
+// untracked batch for libos internals (timer expiries); all or nothing, with a single wake for the lot
+extern error_t PoolSubmitBatch(const CPU::Threading::PoolTask_t * tasks, size_t count);
+
+LIBLINUX_SYM error_t CPU::Threading::SubmitPoolTask(CPU::Threading::PoolTask_f callback, void * context);
+LIBLINUX_SYM error_t CPU::Threading::SubmitPoolTask(CPU::Threading::PoolTask_f callback, void * context, const OOutlivableRef<CPU::Threading::OPoolCompletion> & completion);
+LIBLINUX_SYM error_t CPU::Threading::SubmitPoolTasks(const CPU::Threading::PoolTask_t * tasks, size_t count, const OOutlivableRef<CPU::Threading::OPoolCompletion> & completion);
+LIBLINUX_SYM uint32_t CPU::Threading::GetPoolWorkers();
@@ -0,0 +1,397 @@
+/*
+    Purpose: Coalescing timer service - one sleeping OThread, callbacks dispatched in batches on the thread pool
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "OTimer.hpp"
+#include "OThreadPool.hpp"
+
+#include <Core/CPU/OThread.hpp>
+#include <Core/Synchronization/OSpinlock.hpp>
+#include <Utils/DateHelper.hpp>
+#include "../Synchronization/LinuxSleeping.hpp"
+
+#define TIMER_BATCH_MAX 32  // expiries handed to the pool per submission
+
+static Synchronization::Spinlock timer_lock;    // timer_list, timer_max_slack and the locked fields of every TimerState
+static WaitListHead timer_list;                 // armed timers, sorted by latest
+static uint64_t timer_max_slack;                // largest slack ever used; bounds how far past now the expiry scan has to look
+static volatile long timer_kick;                // an earlier deadline was queued; the service has to recompute its sleep
+static task_k timer_service;
+static CPU::Threading::OThread * timer_thread;
+
+OTimerImpl::OTimerImpl(TimerState * state)
+{
+    _state = state;
+}
+
+static void TimerRelease(TimerState * state)
+{
+    if (_InterlockedDecrement(&state->refs) == 0)
+        free(state);
+}
+
+// under timer_lock
+static void TimerSetExpiry(TimerState * state, uint64_t expires)
+{
+    state->expires = expires;
+    state->latest  = (state->slack >= LINUX_SLEEP_INFINITE - expires) ? LINUX_SLEEP_INFINITE : expires + state->slack;
+}
+
+// under timer_lock. the caller's list reference (or a new one, for fresh arms) moves with the node. true = new head
+static bool TimerInsert(TimerState * state)
+{
+    WaitListNode * pos;
+
+    // from the tail: periodic re-arms and long delays tend to land late
+    for (pos = timer_list.tail; pos; pos = pos->prev)
+    {
+        if (WAIT_LIST_ENTRY(pos, TimerState)->latest <= state->latest)
+            break;
+    }
+
+    WaitListInsertAfter(&timer_list, pos, &state->node);
+    state->queued = true;
+
+    return pos == nullptr;
+}
+
+// under timer_lock
+static void TimerDisarm(TimerState * state)
+{
+    state->generation++;
+    state->pending = false;
+
+    if (!state->queued)
+        return;
+
+    WaitListRemove(&timer_list, &state->node);
+    state->queued = false;
+
+    // the handle still holds a reference, this is never the last
+    TimerRelease(state);
+}
+
+static void TimerKick()
+{
+    // publish, then wake; the service checks the flag after marking itself asleep
+    _InterlockedExchange(&timer_kick, 1);
+    LinuxPokeThread(timer_service);
+}
+
+error_t OTimerImpl::Start(uint64_t delay, uint64_t period)
+{
+    uint64_t expires;
+    bool head;
+
+    CHK_DEAD;
+
+    expires = LinuxSleepDeadlineFromNS(delay);
+
+    timer_lock.Lock();
+
+    TimerDisarm(_state);
+
+    _InterlockedIncrement(&_state->refs);
+
+    _state->period = period;
+    TimerSetExpiry(_state, expires);
+    head = TimerInsert(_state);
+
+    timer_lock.Unlock();
+
+    if (head)
+        TimerKick();
+
+    return kStatusOkay;
+}
+
+error_t OTimerImpl::Stop()
+{
+    CHK_DEAD;
+
+    timer_lock.Lock();
+    TimerDisarm(_state);
+    timer_lock.Unlock();
+
+    return kStatusOkay;
+}
+
+error_t OTimerImpl::IsArmed(bool & armed)
+{
+    CHK_DEAD;
+    armed = _state->queued || _state->pending;
+    return kStatusOkay;
+}
+
+error_t OTimerImpl::SetSlack(uint64_t slack)
+{
+    CHK_DEAD;
+
+    if (slack > TIMER_SLACK_MAX_NS)
+        return kErrorIllegalSize;
+
+    timer_lock.Lock();
+    _state->slack   = slack;
+    timer_max_slack = MAX(timer_max_slack, slack);
+    timer_lock.Unlock();
+
+    return kStatusOkay;
+}
+
+error_t OTimerImpl::GetOverruns(uint64_t & overruns)
+{
+    CHK_DEAD;
+
+    timer_lock.Lock();
+    overruns = _state->overruns;
+    timer_lock.Unlock();
+
+    return kStatusOkay;
+}
+
+void OTimerImpl::InvalidateImp()
+{
+    timer_lock.Lock();
+    TimerDisarm(_state);
+    timer_lock.Unlock();
+
+    TimerRelease(_state);
+}
+
+static void TimerDispatch(void * context)
+{
+    TimerState * state;
+    bool current;
+    bool again;
+
+    state = reinterpret_cast<TimerState *>(context);
+
+    do
+    {
+        // Stop/Start between the expiry and us getting a worker cancels this one
+        timer_lock.Lock();
+        current = state->dispatched == state->generation;
+        timer_lock.Unlock();
+
+        if (current)
+            state->callback(state->context);
+
+        timer_lock.Lock();
+
+        // a one-shot re-armed and expired under us. disarming clears pending, so it's for the current generation
+        again = state->pending;
+        if (again)
+        {
+            state->pending    = false;
+            state->dispatched = state->generation;
+        }
+        else
+        {
+            state->running = false;
+        }
+
+        timer_lock.Unlock();
+
+    } while (again);
+
+    TimerRelease(state);
+}
+
+// under timer_lock. the list reference is either kept (re-armed) or dropped
+static void TimerExpire(TimerState * state, uint64_t now, CPU::Threading::PoolTask_t * batch, size_t & count, WaitListHead * rearm)
+{
+    uint64_t missed;
+
+    WaitListRemove(&timer_list, &state->node);
+
+    if (state->running)
+    {
+        // periods can be skipped; a one-shot expiry can't, so the in-flight dispatch picks it up
+        if (state->period)
+            state->overruns++;
+        else
+            state->pending = true;
+    }
+    else
+    {
+        state->running    = true;
+        state->dispatched = state->generation;
+        _InterlockedIncrement(&state->refs);
+
+        batch[count].callback = TimerDispatch;
+        batch[count].context  = state;
+        count++;
+    }
+
+    if (!state->period)
+    {
+        state->queued = false;
+        TimerRelease(state);
+        return;
+    }
+
+    // skip straight past any periods we slept through, rather than firing them back to back
+    missed = ((now - state->expires) / state->period) + 1;
+    state->overruns += missed - 1;
+
+    if (missed >= (LINUX_SLEEP_INFINITE - state->expires) / state->period)
+        TimerSetExpiry(state, LINUX_SLEEP_INFINITE);
+    else
+        TimerSetExpiry(state, state->expires + (missed * state->period));
+
+    WaitListAppend(rearm, &state->node);
+}
+
+static void TimerServiceExpire()
+{
+    CPU::Threading::PoolTask_t batch[TIMER_BATCH_MAX];
+    WaitListHead rearm;
+    WaitListNode * cur;
+    WaitListNode * next;
+    TimerState * state;
+    uint64_t now;
+    size_t count;
+    bool more;
+    error_t err;
+
+    do
+    {
+        count = 0;
+        more  = false;
+        WaitListInit(&rearm);
+
+        now = DateHelpers::GetBootTime();
+
+        timer_lock.Lock();
+
+        // everything already due goes, not just the timer we woke for; that's the coalescing
+        for (cur = timer_list.head; cur; cur = next)
+        {
+            next  = cur->next;
+            state = WAIT_LIST_ENTRY(cur, TimerState);
+
+            // sorted by latest, so nothing from here on can have expired yet
+            if (state->latest - MIN(state->latest, timer_max_slack) > now)
+                break;
+
+            if (state->expires > now)
+                continue;
+
+            if (count == TIMER_BATCH_MAX)
+            {
+                more = true;
+                break;
+            }
+
+            TimerExpire(state, now, batch, count, &rearm);
+        }
+
+        while ((cur = WaitListPopFront(&rearm)))
+            TimerInsert(WAIT_LIST_ENTRY(cur, TimerState));
+
+        timer_lock.Unlock();
+
+        if (!count)
+            break;
+
+        // one pool wake for the whole batch
+        err = PoolSubmitBatch(batch, count);
+        if (ERROR(err))
+        {
+            LogPrint(kLogWarning, "Timer service: couldn't submit %zu expiries to the pool (error: " PRINTF_ERROR "), running them here", count, err);
+
+            for (size_t i = 0; i < count; i++)
+                TimerDispatch(batch[i].context);
+        }
+
+    } while (more);
+}
+
+static bool TimerServiceKicked(void * context)
+{
+    return timer_kick != 0;
+}
+
+static void TimerServiceEP(CPU::Threading::ThreadMsg_ref msg)
+{
+    uint64_t deadline;
+
+    if (msg->type == CPU::Threading::kMsgThreadCreate)
+    {
+        // before SpawnOThread returns, so the first Start can poke us
+        timer_service = OSThread;
+        return;
+    }
+
+    if (msg->type != CPU::Threading::kMsgThreadStart)
+        return;
+
+    while (true)
+    {
+        _InterlockedExchange(&timer_kick, 0);
+
+        timer_lock.Lock();
+        deadline = WaitListIsEmpty(&timer_list) ? LINUX_SLEEP_INFINITE : WAIT_LIST_ENTRY(timer_list.head, TimerState)->latest;
+        timer_lock.Unlock();
+
+        // the last moment the most urgent timer can be run without overrunning its slack
+        LinuxSleepDeadline(deadline, TimerServiceKicked, nullptr);
+
+        TimerServiceExpire();
+    }
+}
+
+error_t CPU::Threading::CreateTimer(CPU::Threading::TimerCallback_f callback, void * context, const OOutlivableRef<CPU::Threading::OTimer> & timer)
+{
+    return CreateTimer(callback, context, TIMER_SLACK_DEFAULT_NS, timer);
+}
+
+error_t CPU::Threading::CreateTimer(CPU::Threading::TimerCallback_f callback, void * context, uint64_t slack, const OOutlivableRef<CPU::Threading::OTimer> & timer)
+{
+    TimerState * state;
+    OTimerImpl * handle;
+
+    if (!timer_service)
+        return kErrorInternalError;
+
+    if (!callback)
+        return kErrorIllegalBadArgument;
+
+    if (slack > TIMER_SLACK_MAX_NS)
+        return kErrorIllegalSize;
+
+    state = reinterpret_cast<TimerState *>(zalloc(sizeof(TimerState)));
+    if (!state)
+        return kErrorOutOfMemory;
+
+    state->refs     = 1; // the handle
+    state->callback = callback;
+    state->context  = context;
+    state->slack    = slack;
+
+    handle = new OTimerImpl(state);
+    if (!handle)
+    {
+        free(state);
+        return kErrorOutOfMemory;
+    }
+
+    timer_lock.Lock();
+    timer_max_slack = MAX(timer_max_slack, slack);
+    timer_lock.Unlock();
+
+    timer.PassOwnership(handle);
+    return kStatusOkay;
+}
+
+void InitTimers()
+{
+    error_t err;
+
+    WaitListInit(&timer_list);
+
+    err = CPU::Threading::SpawnOThread(timer_thread, TimerServiceEP, "libos_timer", nullptr);
+    ASSERT(NO_ERROR(err), "couldn't spawn timer service: " PRINTF_ERROR, err);
+}
@@ -0,0 +1,53 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/CPU/OTimer.hpp>
+#include "../Synchronization/WaitList.hpp"
+
+// shared between the handle, the service's list and an in-flight dispatch; freed by whichever lets go last
+struct TimerState
+{
+    WaitListNode node;                          // timer_list linkage; must remain first
+    volatile long refs;
+    CPU::Threading::TimerCallback_f callback;
+    void * context;
+
+    // protected by timer_lock
+    uint64_t expires;
+    uint64_t latest;                            // expires + slack; timer_list is sorted on this
+    uint64_t period;
+    uint64_t slack;
+    uint64_t overruns;
+    uint32_t generation;                        // bumped by Start/Stop; dispatches from an older generation don't call back
+    uint32_t dispatched;                        // generation of the in-flight dispatch
+    bool queued;
+    bool running;                               // dispatched and not yet finished
+    bool pending;                               // one-shot expired whilst running; the in-flight dispatch calls back again
+};
+
+class OTimerImpl : public CPU::Threading::OTimer
+{
+public:
+    OTimerImpl(TimerState * state);
+
+    error_t Start(uint64_t delay, uint64_t period)   override;
+    error_t Stop()                                   override;
+    error_t IsArmed(bool & armed)                    override;
+
+    error_t SetSlack(uint64_t slack)                 override;
+    error_t GetOverruns(uint64_t & overruns)         override;
+
+protected:
+    void InvalidateImp()                             override;
+
+private:
+    TimerState * _state;
+};
+
+extern void InitTimers();
+
+LIBLINUX_SYM error_t CPU::Threading::CreateTimer(CPU::Threading::TimerCallback_f callback, void * context, const OOutlivableRef<CPU::Threading::OTimer> & timer);
+LIBLINUX_SYM error_t CPU::Threading::CreateTimer(CPU::Threading::TimerCallback_f callback, void * context, uint64_t slack, const OOutlivableRef<CPU::Threading::OTimer> & timer);
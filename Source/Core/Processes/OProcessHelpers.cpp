@@ -8,6 +8,8 @@
 #include "OProcessHelpers.hpp"
 #include <ITypes/IThreadStruct.hpp>
 #include <ITypes/ITask.hpp>
+#include <ITypes/ISchedEntity.hpp>
+#include <ITypes/ISchedInfo.hpp>
 
 void ProcessesMMIncrementCounter(mm_struct_k mm)
 {
@@ -132,6 +134,22 @@ uint_t ProcessesGetTgid(task_k tsk)
     return ITask(tsk).GetVarTGID().GetUInt();
 }
 
+// caller must keep tsk alive (reference, RCU read section, or the task itself)
+void ProcessesGetTaskStats(task_k tsk, CPU::Threading::ThreadStats_t & stats)
+{
+    ITask task(tsk);
+
+    stats.threadId            = (uint32_t)task.GetVarPID().GetUInt();
+    stats.lastCpu             = (uint32_t)task.GetVarCPU().GetUInt();
+    stats.userTime            = task.GetVarUTime().GetUInt();
+    stats.systemTime          = task.GetVarSTime().GetUInt();
+    stats.runtime             = ISchedEntity(task.GetSE()).GetVarSumExecRuntime().GetUInt();
+    stats.voluntarySwitches   = task.GetVarNVCSW().GetUInt();
+    stats.involuntarySwitches = task.GetVarNIVCSW().GetUInt();
+    stats.runDelay            = ISchedInfo(task.GetSchedInfo()).GetVarRunDelay().GetUInt();
+    stats.timeslices          = ISchedInfo(task.GetSchedInfo()).GetVarPCount().GetUInt();
+}
+
 task_k ProcessesGetGroupLeader(task_k task)
 {
     task_k leader = (task_k)task_get_group_leader_size_t(task);
@@ -4,9 +4,11 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #pragma once
+#include <Core/CPU/OThreadStats.hpp>
 
 extern uint_t ProcessesGetTgid(task_k tsk);
 extern uint_t ProcessesGetPid(task_k tsk);
+extern void   ProcessesGetTaskStats(task_k tsk, CPU::Threading::ThreadStats_t & stats);
 
 extern task_k ProcessesGetGroupLeader(task_k task);
 extern task_k ProcessesGetProcess(task_k task);
@@ -9,18 +9,31 @@
 #include "OProcessTracking.hpp"
 
 #include <Core/CPU/OThread.hpp>
+#include <Core/Synchronization/ORWLock.hpp>
+#include "../CPU/OThreadExit.hpp"
+#include "../../Utils/RCUHashMap.hpp"
 
-static mutex_k tracking_mutex;
+#define TRACKING_MAP_BUCKETS 256
+
+static Synchronization::ORWLock * hooks_lock;     // tracking_exit_cbs, tracking_start_cbs
 static linked_list_head_p tracking_exit_cbs;
 static linked_list_head_p tracking_start_cbs;
-static chain_p tracking_locked;
+static RCUHashMap<bool> tracking_locked;          // tracked pids; looked up lock-free by every task exit
 
 static void ProcessesExit(long exitcode)
 {
-    link_p link;
     linked_list_entry_p entry;
-    error_t err;
     OProcess * proc;
+    uint_t pid;
+
+    pid = thread_geti();
+
+    // subscribed to every task exit in the system; untracked ones leave after a lock-free lookup
+    if (!tracking_locked.Contains(pid))
+        return;
+
+    if (ERROR(tracking_locked.Remove(pid)))
+        return;
 
     proc = new OProcessImpl(OSThread);
     if (!proc)
@@ -29,20 +42,12 @@ static void ProcessesExit(long exitcode)
         return;
     }
 
-    mutex_lock(tracking_mutex);
-   
-    err = chain_get(tracking_locked, thread_geti(), &link, NULL);
-    if (NO_ERROR(err))
+    hooks_lock->ReadLock();
+    for (linked_list_entry_p cur = tracking_exit_cbs->bottom; cur != NULL; cur = cur->next)
     {
-        chain_deallocate_handle(link);
-   
-        for (linked_list_entry_p cur = tracking_exit_cbs->bottom; cur != NULL; cur = cur->next)
-        {
-            (*(ProcessExitNtfy_cb*)(cur->data))(OPtr<OProcess>(proc));
-        }
+        (*(ProcessExitNtfy_cb*)(cur->data))(OPtr<OProcess>(proc));
     }
-   
-    mutex_unlock(tracking_mutex);
+    hooks_lock->ReadUnlock();
 
     proc->Destroy();
 }
@@ -59,12 +64,12 @@ static void ProcessesStart(task_k tsk)
         return;
     }
 
-    mutex_lock(tracking_mutex);
+    hooks_lock->ReadLock();
     for (linked_list_entry_p cur = tracking_start_cbs->bottom; cur != NULL; cur = cur->next)
     {
         (*(ProcessStartNtfy_cb*)(cur->data))(OPtr<OProcess>(proc));
     }
-    mutex_unlock(tracking_mutex);
+    hooks_lock->ReadUnlock();
 
     proc->Destroy();
 }
@@ -75,7 +80,7 @@ error_t ProcessesAddExitHook(ProcessExitNtfy_cb cb)
     error_t ret;
 
     ret = kStatusOkay;
-    mutex_lock(tracking_mutex);
+    hooks_lock->WriteLock();
 
     entry = linked_list_append(tracking_exit_cbs, sizeof(ProcessExitNtfy_cb));
     if (!entry)
@@ -87,7 +92,7 @@ error_t ProcessesAddExitHook(ProcessExitNtfy_cb cb)
     *(ProcessExitNtfy_cb*)(entry->data) = cb;
 
 exit:
-    mutex_unlock(tracking_mutex);
+    hooks_lock->WriteUnlock();
     return ret;
 }
 
@@ -97,7 +102,7 @@ error_t ProcessesAddStartHook(ProcessStartNtfy_cb cb)
     error_t ret;
 
     ret = kStatusOkay;
-    mutex_lock(tracking_mutex);
+    hooks_lock->WriteLock();
 
     entry = linked_list_append(tracking_start_cbs, sizeof(ProcessStartNtfy_cb));
     if (!entry)
@@ -109,7 +114,7 @@ error_t ProcessesAddStartHook(ProcessStartNtfy_cb cb)
     *(ProcessStartNtfy_cb*)(entry->data) = cb;
 
 exit:
-    mutex_unlock(tracking_mutex);
+    hooks_lock->WriteUnlock();
     return ret;
 }
 
@@ -119,7 +124,7 @@ error_t ProcessesRemoveExitHook(ProcessExitNtfy_cb cb)
     error_t ret;
 
     ret = kErrorCallbackNotFound;
-    mutex_lock(tracking_mutex);
+    hooks_lock->WriteLock();
 
     for (linked_list_entry_p cur = tracking_exit_cbs->bottom; cur != NULL; cur = cur->next)
     {
@@ -133,7 +138,7 @@ error_t ProcessesRemoveExitHook(ProcessExitNtfy_cb cb)
 
 
 exit:
-    mutex_unlock(tracking_mutex);
+    hooks_lock->WriteUnlock();
 
     return ret;
 }
@@ -144,7 +149,7 @@ error_t ProcessesRemoveStartHook(ProcessStartNtfy_cb cb)
     error_t ret;
 
     ret = kErrorCallbackNotFound;
-    mutex_lock(tracking_mutex);
+    hooks_lock->WriteLock();
 
     for (linked_list_entry_p cur = tracking_start_cbs->bottom; cur != NULL; cur = cur->next)
     {
@@ -157,35 +162,14 @@ error_t ProcessesRemoveStartHook(ProcessStartNtfy_cb cb)
     }
 
 exit:
-    mutex_unlock(tracking_mutex);
+    hooks_lock->WriteUnlock();
 
     return ret;
 }
 
-static void ProcessTrackingInitExitHandler(task_k task)
-{
-    thread_exit_cb_t * cb_arr;
-    int cb_cnt;
-    int i = 0;
-
-    threading_get_exit_callbacks(&cb_arr, &cb_cnt);
-
-    while (cb_arr[i])
-    {
-        i++;
-        if (i >= cb_cnt)
-        {
-            panic("couldn't install thread exit callback for libos process tracking");
-        }
-    }
-
-    cb_arr[i] = ProcessesExit;
-}
-
 static void ProcessesRegisterTsk(task_k tsk)
 {
     ProcessesStart(tsk);
-    ProcessTrackingInitExitHandler(tsk);
     //threading_ntfy_singleshot_exit(ProcessesGetPid(tsk), ProcessesExit);
 }
 
@@ -193,9 +177,7 @@ static void ProcessesTryRegister(task_k tsk)
 {
     error_t er;
     
-    mutex_lock(tracking_mutex);
-    er = chain_allocate_link(tracking_locked, ProcessesGetPid(tsk), 2, NULL, NULL, NULL);
-    mutex_unlock(tracking_mutex);
+    er = tracking_locked.Insert(ProcessesGetPid(tsk), true);
 
     ASSERT(NO_ERROR(er), "couldn't register thread pid / ProcessesRegisterTsk");
 
@@ -212,8 +194,9 @@ void InitProcessTracking()
 {
     error_t err;
 
-    tracking_mutex = mutex_create();
-    ASSERT(tracking_mutex, "couldn't create thread tracking mutex");
+    err = Synchronization::CreateRWLock(true, hooks_lock);
+    ASSERT(NO_ERROR(err), "couldn't create tracking hooks lock");
+    hooks_lock->EnableProfiling("tracking_hooks");
     
     tracking_exit_cbs = linked_list_create();
     ASSERT(tracking_exit_cbs, "couldn't create tracking_exit_cbs");
@@ -221,6 +204,9 @@ void InitProcessTracking()
     tracking_start_cbs = linked_list_create();
     ASSERT(tracking_start_cbs, "couldn't create tracking_start_cbs");
 
-    err = chain_allocate(&tracking_locked);
+    err = tracking_locked.Init(TRACKING_MAP_BUCKETS);
     ASSERT(NO_ERROR(err), "couldn't create tracking_locked");
+
+    err = ThreadExitSubscribe(ProcessesExit);
+    ASSERT(NO_ERROR(err), "couldn't subscribe to thread exits");
 }
@@ -252,6 +252,44 @@ error_t OProcessImpl::GetThreadById(uint_t id, const OOutlivableRef<OProcessThre
 }
 
 
+struct TempThreadStatsData
+{
+    CPU::Threading::ThreadStats_t * stats;
+    uint_t count;
+    uint_t found;
+};
+
+static bool ThreadStatsCallback(const ThreadFoundEntry * thread, void * data)
+{
+    TempThreadStatsData * priv = reinterpret_cast<TempThreadStatsData *>(data);
+
+    // still inside the transversal's RCU read section, so the task can't go away under us
+    if (priv->found < priv->count)
+        ProcessesGetTaskStats(thread->task, priv->stats[priv->found]);
+
+    priv->found++;
+    return true;
+}
+
+error_t OProcessImpl::GetThreadStats(CPU::Threading::ThreadStats_t * stats, uint_t count, uint_t * threads)
+{
+    CHK_DEAD;
+    TempThreadStatsData temp;
+
+    if (!threads || (!stats && count))
+        return kErrorIllegalBadArgument;
+
+    temp.stats = stats;
+    temp.count = count;
+    temp.found = 0;
+
+    LinuxTransverseThreadsInProcess(_tsk, ThreadStatsCallback, &temp);
+
+    *threads = temp.found;
+    return temp.found > count ? kErrorIllegalSize : kStatusOkay;
+}
+
+
 struct TempThreadIterationData
 {
     ThreadIterator_cb callback;
@@ -39,6 +39,7 @@ public:
     uint_t  GetThreadCount()                                                                     override;
     error_t IterateThreads(ThreadIterator_cb callback, void * ctx)                               override;
     error_t GetThreadById(uint_t id, const OOutlivableRef<OProcessThread> & thread)              override;
+    error_t GetThreadStats(CPU::Threading::ThreadStats_t * stats, uint_t count, uint_t * threads) override;
                                                                                                  
     error_t Terminate(bool force)                                                                override;
 
@@ -90,3 +90,14 @@ error_t OProcessThreadImpl::AsProcess(const OOutlivableRef<OProcess> parent)
 
     return kStatusOkay;
 }
+
+error_t OProcessThreadImpl::GetStats(CPU::Threading::ThreadStats_t * stats)
+{
+    CHK_DEAD;
+
+    if (!stats)
+        return kErrorIllegalBadArgument;
+
+    ProcessesGetTaskStats(_tsk, *stats);
+    return kStatusOkay;
+}
@@ -20,6 +20,8 @@ public:
 
     error_t IsProcess(bool * out)                                override;
     error_t AsProcess(const OOutlivableRef<OProcess> parent)     override;
+
+    error_t GetStats(CPU::Threading::ThreadStats_t * stats)      override;
 protected:
     void InvalidateImp();
 
@@ -7,61 +7,74 @@
 #include <Utils/DateHelper.hpp>
 #include <ITypes/IThreadStruct.hpp>
 #include <ITypes/ITask.hpp>
+#include <Core/CPU/OPerCpuCounter.hpp>
 #include "LinuxSleeping.hpp"
+#include "../Processes/OProcessHelpers.hpp"
 
-struct SleepState
+uint64_t LinuxSleepDeadlineFromMS(uint32_t ms)
 {
-    bool timeoutable;
-    int64_t timeout;
-};
+    if (ms == -1)
+        return LINUX_SLEEP_INFINITE;
+
+    return DateHelpers::GetBootTime() + MS_TO_NS(uint64_t(ms));
+}
 
-static struct SleepState GetSleepState(uint32_t ms)
+uint64_t LinuxSleepDeadlineFromNS(uint64_t ns)
 {
-    SleepState state = { 0 };
+    uint64_t now;
 
-    if (ms == -1)
-        return state;
+    if (ns == LINUX_SLEEP_INFINITE)
+        return LINUX_SLEEP_INFINITE;
 
-    state.timeout     = MAX(1, MSToOSTicks(ms));
-    state.timeoutable = true;
+    now = DateHelpers::GetBootTime();
 
-    return state;
+    // saturate rather than wrap into the past
+    if (ns >= LINUX_SLEEP_INFINITE - now)
+        return LINUX_SLEEP_INFINITE;
+
+    return now + ns;
 }
 
-static inline bool LinuxSleepTimedout(struct SleepState * state)
+// set_current_state(): the store has to be visible before we read the wake condition, so a plain barrier won't do.
+// the waker stores its condition and then reads our state in try_to_wake_up (fully ordered), so one side always sees the other
+static void LinuxSetCurrentState(ITask & tsk, uint_t state)
 {
-    return state->timeoutable && state->timeout == 0;
+    tsk.GetVarState().Set(state);
+    _mm_mfence();
 }
 
-bool LinuxSleep(uint32_t ms, bool(*callback)(void * context), void * context)
+static bool LinuxSleepDeadlineState(uint64_t deadline, uint_t state, bool(*callback)(void * context), void * context)
 {
     ITask tsk(OSThread);
     bool signaled = false;
     uint_t ustate = 0;
-    struct SleepState state;
+    ktime_t expires;
 
-    state  = GetSleepState(ms);
     ustate = tsk.GetVarState().GetUInt();
 
     while (true)
     {
+        // publish our sleeping state *before* checking the condition - a waker that flips it after our check will find us asleep and wake us
+        LinuxSetCurrentState(tsk, state);
+
         if (callback(context))
         {
             signaled = true;
             break;
         }
 
-        if (LinuxSleepTimedout(&state))
-            break;
-
-        if (state.timeoutable)
+        if (deadline == LINUX_SLEEP_INFINITE)
         {
-            state.timeout = schedule_timeout_interruptible(state.timeout);
+            schedule();
             continue;
         }
 
-        tsk.GetVarState().Set((uint_t)TASK_INTERRUPTIBLE);
-        schedule();
+        // absolute deadline: early and spurious wakeups retry against the same expiry
+        if (DateHelpers::GetBootTime() >= deadline)
+            break;
+
+        expires = ktime_t(deadline);
+        schedule_hrtimeout_range_clock(&expires, LINUX_SLEEP_SLACK_NS, HRTIMER_MODE_ABS, CLOCK_BOOTTIME);
     }
 
     tsk.GetVarState().Set(ustate);
@@ -69,7 +82,203 @@ bool LinuxSleep(uint32_t ms, bool(*callback)(void * context), void * context)
     return signaled;
 }
 
+bool LinuxSleepDeadline(uint64_t deadline, bool(*callback)(void * context), void * context)
+{
+    return LinuxSleepDeadlineState(deadline, (uint_t)TASK_INTERRUPTIBLE, callback, context);
+}
+
+bool LinuxSleepDeadlineUninterruptible(uint64_t deadline, bool(*callback)(void * context), void * context)
+{
+    return LinuxSleepDeadlineState(deadline, (uint_t)TASK_UNINTERRUPTIBLE, callback, context);
+}
+
+bool LinuxSleep(uint32_t ms, bool(*callback)(void * context), void * context)
+{
+    return LinuxSleepDeadline(LinuxSleepDeadlineFromMS(ms), callback, context);
+}
+
+bool LinuxPoll(uint64_t budget, uint64_t deadline, bool(*callback)(void * context), void * context)
+{
+    uint64_t now;
+    uint64_t end;
+
+    if (!budget)
+        return false;
+
+    now = DateHelpers::GetBootTime();
+    end = (budget >= deadline - MIN(now, deadline)) ? deadline : now + budget;
+
+    while (true)
+    {
+        for (uint32_t i = 0; i < LINUX_POLL_CLOCK_INTERVAL; i++)
+        {
+            if (callback(context))
+                return true;
+
+            thread_pause();
+        }
+
+        if (DateHelpers::GetBootTime() >= end)
+            return callback(context);
+    }
+}
+
+bool LinuxSleepDeadlinePoll(uint64_t deadline, uint64_t budget, bool(*callback)(void * context), void * context, LinuxPollStats * stats)
+{
+    if (!budget)
+        return LinuxSleepDeadline(deadline, callback, context);
+
+    if (LinuxPoll(budget, deadline, callback, context))
+    {
+        _InterlockedIncrement64(&stats->pollHits);
+        return true;
+    }
+
+    _InterlockedIncrement64(&stats->sleeps);
+    return LinuxSleepDeadline(deadline, callback, context);
+}
+
 void LinuxPokeThread(task_k task)
 {
     wake_up_process(task);
 }
+
+void LinuxWaiterInit(LinuxWaiter * waiter)
+{
+    waiter->thread = OSThread;
+    waiter->signal = false;
+    waiter->queued = false;
+    waiter->cpu    = CPU::GetCurrentCPU();
+}
+
+void LinuxWaiterEnqueue(WaitListHead * list, LinuxWaiter * waiter)
+{
+    waiter->queued = true;
+    WaitListAppend(list, &waiter->node);
+}
+
+bool LinuxWaiterFinish(WaitListHead * list, LinuxWaiter * waiter)
+{
+    if (waiter->queued)
+    {
+        // timed out (or woke spuriously) whilst still parked
+        WaitListRemove(list, &waiter->node);
+        waiter->queued = false;
+        return false;
+    }
+
+    // claimed by a waker that is yet to reach us - it no longer needs the lock to finish the job
+    while (!waiter->signal)
+        thread_pause();
+
+    return true;
+}
+
+bool LinuxWaiterIsSignaled(void * context)
+{
+    return reinterpret_cast<LinuxWaiter *>(context)->signal;
+}
+
+void LinuxWakeQueueInit(LinuxWakeQueue * queue)
+{
+    WaitListInit(&queue->list);
+}
+
+void LinuxWakeQueueClaim(LinuxWakeQueue * queue, WaitListHead * list, LinuxWaiter * waiter)
+{
+    WaitListRemove(list, &waiter->node);
+    waiter->queued = false;
+    WaitListAppend(&queue->list, &waiter->node);
+}
+
+size_t LinuxWakeQueueClaimAll(LinuxWakeQueue * queue, WaitListHead * list)
+{
+    size_t claimed = 0;
+
+    while (!WaitListIsEmpty(list))
+    {
+        LinuxWakeQueueClaim(queue, list, WAIT_LIST_ENTRY(list->head, LinuxWaiter));
+        claimed++;
+    }
+
+    return claimed;
+}
+
+size_t LinuxWakeQueueWake(LinuxWakeQueue * queue)
+{
+    WaitListNode * cur;
+    WaitListNode * next;
+    size_t woken = 0;
+
+    for (cur = queue->list.head; cur; cur = next)
+    {
+        LinuxWaiter * waiter;
+        task_k thread;
+
+        waiter = WAIT_LIST_ENTRY(cur, LinuxWaiter);
+        next   = cur->next;
+        thread = waiter->thread;
+
+        // the moment signal is set the waiter may return, taking its node and possibly its task with it
+        ProcessesTaskIncrementCounter(thread);
+        waiter->signal = true;
+        LinuxPokeThread(thread);
+        ProcessesTaskDecrementCounter(thread);
+
+        woken++;
+    }
+
+    WaitListInit(&queue->list);
+    return woken;
+}
+
+LinuxWaiter * LinuxWaiterPick(WaitListHead * list, Synchronization::WakePolicy_e policy)
+{
+    WaitListNode * cur;
+    uint32_t cpu;
+
+    switch (policy)
+    {
+    case Synchronization::kWakeLifo:
+        return WAIT_LIST_ENTRY(list->tail, LinuxWaiter);
+
+    case Synchronization::kWakeCpuLocal:
+        cpu = CPU::GetCurrentCPU();
+        cur = list->head;
+
+        for (size_t i = 0; cur && (i < LINUX_WAKE_LOCAL_SCAN); i++, cur = cur->next)
+        {
+            if (WAIT_LIST_ENTRY(cur, LinuxWaiter)->cpu == cpu)
+                return WAIT_LIST_ENTRY(cur, LinuxWaiter);
+        }
+
+        return WAIT_LIST_ENTRY(list->head, LinuxWaiter);
+
+    case Synchronization::kWakeFifo:
+    default:
+        return WAIT_LIST_ENTRY(list->head, LinuxWaiter);
+    }
+}
+
+void LinuxWakeQueueClaimPolicy(LinuxWakeQueue * queue, WaitListHead * list, LinuxWaiter * waiter, LinuxWakeStats * stats)
+{
+    stats->wakes++;
+
+    if (waiter->cpu == CPU::GetCurrentCPU())
+        stats->localWakes++;
+
+    LinuxWakeQueueClaim(queue, list, waiter);
+}
+
+size_t LinuxWakeQueueClaimMany(LinuxWakeQueue * queue, WaitListHead * list, size_t count, Synchronization::WakePolicy_e policy, LinuxWakeStats * stats)
+{
+    size_t claimed = 0;
+
+    while ((claimed < count) && !WaitListIsEmpty(list))
+    {
+        LinuxWakeQueueClaimPolicy(queue, list, LinuxWaiterPick(list, policy), stats);
+        claimed++;
+    }
+
+    return claimed;
+}
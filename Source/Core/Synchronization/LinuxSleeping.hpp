@@ -4,6 +4,75 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #pragma once
+#include <Core/Synchronization/OWakePolicy.hpp>
+#include "WaitList.hpp"
 
+// deadlines are absolute DateHelpers::GetBootTime() nanoseconds, backed by a CLOCK_BOOTTIME hrtimer
+#define LINUX_SLEEP_INFINITE UINT64_MAX
+#define LINUX_SLEEP_SLACK_NS 1000
+
+extern uint64_t LinuxSleepDeadlineFromMS(uint32_t ms);  // -1 = infinite
+extern uint64_t LinuxSleepDeadlineFromNS(uint64_t ns);  // relative -> absolute
+
+// callback is evaluated with the task already TASK_INTERRUPTIBLE (published with a full fence), so a wake between the check and schedule() can't be lost.
+// it must only inspect memory: anything that blocks (sleeping locks, allocations, user callbacks) resets the task state and turns the sleep into a spin
+extern bool LinuxSleepDeadline(uint64_t deadline, bool(*callback)(void * context), void * context);
+// TASK_UNINTERRUPTIBLE (mutex_lock style): with a signal pending, an interruptible schedule() returns at once and the sleep degrades into a spin.
+// for waits that can't back out on a signal, such as lock acquisition
+extern bool LinuxSleepDeadlineUninterruptible(uint64_t deadline, bool(*callback)(void * context), void * context);
 extern bool LinuxSleep(uint32_t ms, bool(*callback)(void * context), void * context);
 extern void LinuxPokeThread(task_k task);
+
+// busy-poll mode: spin on the callback with thread_pause() for up to budget ns (capped at the deadline) before sleeping
+#define LINUX_POLL_CLOCK_INTERVAL 32   // pauses between clock reads
+#define LINUX_POLL_BUDGET_MAX_NS  (1000 * 1000)   // quoted as 1ms by the public SetPollBudget docs
+
+// per-object poll counters; only updated when a budget is set
+struct LinuxPollStats
+{
+    volatile int64_t pollHits;
+    volatile int64_t sleeps;
+};
+
+extern bool LinuxPoll(uint64_t budget, uint64_t deadline, bool(*callback)(void * context), void * context); // true = callback fired within the budget
+extern bool LinuxSleepDeadlinePoll(uint64_t deadline, uint64_t budget, bool(*callback)(void * context), void * context, LinuxPollStats * stats);
+
+// On-stack waiter shared by the synchronization objects. Must remain the first member of any extended waiter context.
+struct LinuxWaiter
+{
+    WaitListNode  node;
+    task_k        thread;
+    volatile bool signal;
+    bool          queued;  // protected by the owning object's lock
+    uint32_t      cpu;     // where we parked; the scheduler tends to wake us there
+};
+
+#define LINUX_WAKE_LOCAL_SCAN 8 // kWakeCpuLocal gives up looking for a local waiter after this many
+
+// per-object wake counters, updated under the owning object's lock
+struct LinuxWakeStats
+{
+    uint64_t wakes;
+    uint64_t localWakes;
+};
+
+// wake_q style batch: waiters are claimed under the object's lock and woken once the lock has been dropped
+struct LinuxWakeQueue
+{
+    WaitListHead list;
+};
+
+extern void   LinuxWaiterInit(LinuxWaiter * waiter);
+extern void   LinuxWaiterEnqueue(WaitListHead * list, LinuxWaiter * waiter);
+extern bool   LinuxWaiterFinish(WaitListHead * list, LinuxWaiter * waiter); // call under lock after sleeping; true = claimed by a waker
+extern bool   LinuxWaiterIsSignaled(void * context);
+
+extern void   LinuxWakeQueueInit(LinuxWakeQueue * queue);
+extern void   LinuxWakeQueueClaim(LinuxWakeQueue * queue, WaitListHead * list, LinuxWaiter * waiter);
+extern size_t LinuxWakeQueueClaimAll(LinuxWakeQueue * queue, WaitListHead * list);
+extern size_t LinuxWakeQueueWake(LinuxWakeQueue * queue);
+
+// policy aware variants of the above. list must not be empty for Pick
+extern LinuxWaiter * LinuxWaiterPick(WaitListHead * list, Synchronization::WakePolicy_e policy);
+extern void   LinuxWakeQueueClaimPolicy(LinuxWakeQueue * queue, WaitListHead * list, LinuxWaiter * waiter, LinuxWakeStats * stats);
+extern size_t LinuxWakeQueueClaimMany(LinuxWakeQueue * queue, WaitListHead * list, size_t count, Synchronization::WakePolicy_e policy, LinuxWakeStats * stats); // -1 = all
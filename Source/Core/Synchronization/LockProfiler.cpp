@@ -0,0 +1,276 @@
+/*
+    Purpose: Optional per-lock contention statistics, exported through a pseudo file
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "LockProfiler.hpp"
+
+#include <Utils/DateHelper.hpp>
+#include <Core/Synchronization/OSpinlock.hpp>
+#include <Core/UserSpace/OPseudoFile.hpp>
+#include <Core/CPU/OPerCpuCounter.hpp>
+
+#if LIBOS_LOCK_PROFILING
+
+#define LOCK_PROFILE_MAX_RENDER (256 * 1024)
+
+struct __declspec(align(SPINLOCK_CACHE_LINE)) LockProfileCPU
+{
+    volatile int64_t acquisitions;
+    volatile int64_t contended;
+    volatile int64_t waitNs;
+    volatile int64_t holdNs;
+    volatile long    waitHistogram[LOCK_PROFILE_BUCKETS];
+    volatile long    holdHistogram[LOCK_PROFILE_BUCKETS];
+};
+
+struct LockProfile
+{
+    LockProfile * next;
+    char name[LOCK_PROFILE_NAME_LENGTH];
+    LockProfileCPU * cpus;
+    void * allocation;      // unaligned cpus
+};
+
+static Synchronization::Spinlock profile_lock;
+static LockProfile * profile_head;
+static OPseudoFile * profile_file;
+
+static LockProfileCPU * LockProfileGetCPU(LockProfile * profile)
+{
+    // migrating between reading the id and updating the slot is harmless; all updates are atomic
+    return &profile->cpus[CPU::GetCurrentCPU()];
+}
+
+static uint32_t LockProfileBucket(uint64_t ns)
+{
+    unsigned long index;
+
+    if (!_BitScanReverse64(&index, ns | 1))
+        return 0;
+
+    if (index < 7)
+        return 0;
+
+    return MIN(uint32_t(index - 6), LOCK_PROFILE_BUCKETS - 1);
+}
+
+// under profile_lock
+static LockProfile * LockProfileFind(const char * name)
+{
+    for (LockProfile * profile = profile_head; profile; profile = profile->next)
+    {
+        if (strncmp(profile->name, name, LOCK_PROFILE_NAME_LENGTH - 1) == 0)
+            return profile;
+    }
+
+    return nullptr;
+}
+
+LockProfile * LockProfileRegister(const char * name)
+{
+    LockProfile * profile;
+    LockProfile * existing;
+    uint32_t cpus;
+
+    if (!name)
+        return nullptr;
+
+    cpus = CPU::GetPossibleCPUs();
+
+    profile_lock.Lock();
+    existing = LockProfileFind(name);
+    profile_lock.Unlock();
+
+    if (existing)
+        return existing;
+
+    profile = reinterpret_cast<LockProfile *>(zalloc(sizeof(LockProfile)));
+    if (!profile)
+        return nullptr;
+
+    // zalloc only guarantees 16 byte alignment; over-allocate so each slot gets a line of its own
+    profile->allocation = zalloc(sizeof(LockProfileCPU) * (cpus + 1));
+    if (!profile->allocation)
+    {
+        free(profile);
+        return nullptr;
+    }
+    profile->cpus = reinterpret_cast<LockProfileCPU *>((size_t(profile->allocation) + SPINLOCK_CACHE_LINE - 1) & ~size_t(SPINLOCK_CACHE_LINE - 1));
+
+    memcpy(profile->name, name, MIN(strlen(name), sizeof(profile->name) - 1));
+
+    profile_lock.Lock();
+
+    // someone else may have registered the same name whilst we were allocating; one row per name
+    existing = LockProfileFind(name);
+    if (!existing)
+    {
+        profile->next = profile_head;
+        profile_head  = profile;
+    }
+
+    profile_lock.Unlock();
+
+    if (existing)
+    {
+        free(profile->allocation);
+        free(profile);
+        return existing;
+    }
+
+    return profile;
+}
+
+uint64_t LockProfileTimestamp()
+{
+    return DateHelpers::GetBootTime();
+}
+
+void LockProfileAcquired(LockProfile * profile, uint64_t start, uint64_t now, bool contended)
+{
+    LockProfileCPU * cpu;
+    uint64_t wait;
+
+    cpu  = LockProfileGetCPU(profile);
+    wait = now - start;
+
+    _InterlockedIncrement64(&cpu->acquisitions);
+    _InterlockedExchangeAdd64(&cpu->waitNs, int64_t(wait));
+    _InterlockedIncrement(&cpu->waitHistogram[LockProfileBucket(wait)]);
+
+    if (contended)
+        _InterlockedIncrement64(&cpu->contended);
+}
+
+void LockProfileReleased(LockProfile * profile, uint64_t acquired)
+{
+    LockProfileCPU * cpu;
+    uint64_t hold;
+
+    if (!acquired)
+        return;
+
+    cpu  = LockProfileGetCPU(profile);
+    hold = LockProfileTimestamp() - acquired;
+
+    _InterlockedExchangeAdd64(&cpu->holdNs, int64_t(hold));
+    _InterlockedIncrement(&cpu->holdHistogram[LockProfileBucket(hold)]);
+}
+
+static size_t LockProfileRenderHistogram(char * buffer, size_t length, const char * label, uint64_t * histogram)
+{
+    size_t index;
+
+    index = snprintf(buffer, length, "  %s:", label);
+    for (uint32_t i = 0; (i < LOCK_PROFILE_BUCKETS) && (index < length); i++)
+        index += snprintf(buffer + index, length - index, " %llu", histogram[i]);
+
+    if (index < length)
+        index += snprintf(buffer + index, length - index, "\n");
+
+    return MIN(index, length);
+}
+
+static size_t LockProfileRenderOne(char * buffer, size_t length, LockProfile * profile)
+{
+    uint64_t acquisitions = 0, contended = 0, waitNs = 0, holdNs = 0;
+    uint64_t waitHistogram[LOCK_PROFILE_BUCKETS] = { 0 };
+    uint64_t holdHistogram[LOCK_PROFILE_BUCKETS] = { 0 };
+    size_t index;
+
+    // sum the per-cpu slots; a snapshot taken under load is approximate by nature
+    for (uint32_t i = 0; i < CPU::GetPossibleCPUs(); i++)
+    {
+        LockProfileCPU * cpu = &profile->cpus[i];
+
+        acquisitions += cpu->acquisitions;
+        contended    += cpu->contended;
+        waitNs       += cpu->waitNs;
+        holdNs       += cpu->holdNs;
+
+        for (uint32_t j = 0; j < LOCK_PROFILE_BUCKETS; j++)
+        {
+            waitHistogram[j] += uint32_t(cpu->waitHistogram[j]);
+            holdHistogram[j] += uint32_t(cpu->holdHistogram[j]);
+        }
+    }
+
+    index = snprintf(buffer, length, "%s: acquisitions %llu contended %llu wait_ns %llu hold_ns %llu\n", profile->name, acquisitions, contended, waitNs, holdNs);
+    if (index >= length)
+        return length;
+
+    index += LockProfileRenderHistogram(buffer + index, length - index, "wait", waitHistogram);
+    if (index >= length)
+        return length;
+
+    index += LockProfileRenderHistogram(buffer + index, length - index, "hold", holdHistogram);
+    return MIN(index, length);
+}
+
+static size_t LockProfileRender(char * buffer, size_t length)
+{
+    LockProfile * profile;
+    size_t index;
+
+    index = snprintf(buffer, length, "# histogram bucket n = [2^(n + 6), 2^(n + 7)) ns, bucket 0 includes everything below\n");
+
+    // the list is append-at-head only and never freed, so walking it without the lock is safe
+    for (profile = profile_head; profile && (index < length); profile = profile->next)
+        index += LockProfileRenderOne(buffer + index, length - index, profile);
+
+    return MIN(index, length);
+}
+
+static bool LockProfileOnRead(OPtr<OPseudoFile> file, void * context, void * buffer, size_t length, size_t off, size_t * bytesCopied)
+{
+    char * text;
+    size_t size;
+
+    text = reinterpret_cast<char *>(zalloc(LOCK_PROFILE_MAX_RENDER));
+    if (!text)
+        return false;
+
+    size = LockProfileRender(text, LOCK_PROFILE_MAX_RENDER);
+
+    if (off >= size)
+    {
+        *bytesCopied = 0;
+    }
+    else
+    {
+        *bytesCopied = MIN(length, size - off);
+        memcpy(buffer, text + off, *bytesCopied);
+    }
+
+    free(text);
+    return true;
+}
+
+void InitLockProfiler()
+{
+    error_t err;
+    const char * path;
+
+    err = CreateTempKernFile(profile_file);
+    if (ERROR(err))
+    {
+        LogPrint(kLogWarning, "Couldn't create lock profiler pseudo file: " PRINTF_ERROR, err);
+        return;
+    }
+
+    profile_file->OnUserRead(LockProfileOnRead);
+
+    if (NO_ERROR(profile_file->GetPath(&path)))
+        LogPrint(kLogInfo, "Lock profiler statistics available at %s", path);
+}
+
+#else
+
+void InitLockProfiler()
+{
+
+}
+
+#endif
@@ -0,0 +1,39 @@
+/*
+    Purpose: Optional per-lock contention statistics
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+// compile time switch, off by default: define LIBOS_LOCK_PROFILING=1 for a diagnostic build.
+// when off, EnableProfiling leaves the lock unnamed and acquire/release keep their unprofiled fast paths.
+// when on, only objects that have been named via EnableProfiling pay for timestamps
+#if !defined(LIBOS_LOCK_PROFILING)
+    #define LIBOS_LOCK_PROFILING 0
+#endif
+
+#define LOCK_PROFILE_NAME_LENGTH  48
+#define LOCK_PROFILE_BUCKETS      24    // log2 ns buckets; [0] = < 128ns, [n] = < 2^(n + 7)ns, last = everything else
+#define LOCK_PROFILE_CONTENDED_NS 1000  // sleeping kernel mutexes can't tell us if they blocked; assume so past this
+
+struct LockProfile;
+
+#if LIBOS_LOCK_PROFILING
+
+// profiles are never freed: destroyed locks keep their history, recreated locks with the same name aggregate into it
+extern LockProfile * LockProfileRegister(const char * name);
+
+extern uint64_t LockProfileTimestamp();
+extern void     LockProfileAcquired(LockProfile * profile, uint64_t start, uint64_t now, bool contended);
+extern void     LockProfileReleased(LockProfile * profile, uint64_t acquired);
+
+#else
+
+static inline LockProfile * LockProfileRegister(const char * name)                                   { return nullptr; }
+static inline uint64_t      LockProfileTimestamp()                                                   { return 0; }
+static inline void          LockProfileAcquired(LockProfile *, uint64_t, uint64_t, bool)             {}
+static inline void          LockProfileReleased(LockProfile *, uint64_t)                             {}
+
+#endif
+
+extern void InitLockProfiler();
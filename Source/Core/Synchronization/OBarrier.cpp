@@ -0,0 +1,63 @@
+/*
+    Purpose: Generation counted barrier on top of WaitOnAddress
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "OBarrier.hpp"
+
+#include <Core/Synchronization/OSpinlock.hpp>
+#include <Core/Synchronization/OWaitOnAddress.hpp>
+
+Synchronization::OBarrier::OBarrier(uint32_t participants, uint32_t spin)
+{
+    ASSERT(participants, "barrier with no participants");
+
+    _participants = participants;
+    _spin         = spin;
+    _remaining    = long(participants);
+    _generation   = 0;
+}
+
+bool Synchronization::OBarrier::Arrive()
+{
+    uint32_t generation;
+    uint32_t woken;
+
+    // the generation can't move until we've decremented, so this is our phase
+    generation = _generation;
+    _ReadWriteBarrier();
+
+    if (_InterlockedDecrement(&_remaining) == 0)
+    {
+        // rearm before releasing anyone; nobody can arrive for the next phase until they see the new generation
+        _remaining = long(_participants);
+        _InterlockedIncrement(reinterpret_cast<volatile long *>(&_generation));
+
+        WakeByAddress(&_generation, -1, woken);
+        return true;
+    }
+
+    for (uint32_t i = 0; i < _spin; i++)
+    {
+        if (_generation != generation)
+            return false;
+
+        SPINLOOP_PROCYIELD();
+    }
+
+    while (_generation == generation)
+        WaitOnAddress(&_generation, generation);
+
+    return false;
+}
+
+uint32_t Synchronization::OBarrier::GetGeneration()
+{
+    return _generation;
+}
+
+uint32_t Synchronization::OBarrier::GetParticipants()
+{
+    return _participants;
+}
@@ -0,0 +1,149 @@
+/*
+    Purpose: Condition variable with wait morphing onto the adaptive mutex
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "OConditionVariable.hpp"
+
+#include "OMutex.hpp"
+#include "LinuxSleeping.hpp"
+
+struct ConditionWaiter
+{
+    LinuxWaiter waiter;
+    bool morphed;       // moved onto the mutex's wait list; set under both locks
+};
+
+OConditionVariableImpl::OConditionVariableImpl()
+{
+    _morphTarget = nullptr;
+    WaitListInit(&_waiters);
+}
+
+error_t OConditionVariableImpl::Wait(Synchronization::OMutex * mutex, uint32_t ms)
+{
+    CHK_DEAD;
+    return WaitUntil(mutex, LinuxSleepDeadlineFromMS(ms));
+}
+
+error_t OConditionVariableImpl::WaitUntil(Synchronization::OMutex * mutex, uint64_t deadline)
+{
+    CHK_DEAD;
+    ConditionWaiter entry;
+    OAdaptiveMutexImpl * adaptive;
+    bool signaled;
+
+    if (!mutex)
+        return kErrorIllegalBadArgument;
+
+    adaptive = mutex->GetMode() == Synchronization::kMutexAdaptive ? static_cast<OAdaptiveMutexImpl *>(mutex) : nullptr;
+
+    LinuxWaiterInit(&entry.waiter);
+    entry.morphed = false;
+
+    // queue up before dropping the mutex, so a signal issued the moment we let go still finds us
+    _lock.Lock();
+    _morphTarget = adaptive;
+    LinuxWaiterEnqueue(&_waiters, &entry.waiter);
+    _lock.Unlock();
+
+    mutex->Unlock();
+
+    LinuxSleepDeadline(deadline, LinuxWaiterIsSignaled, &entry.waiter);
+
+    _lock.Lock();
+    if (!entry.morphed)
+    {
+        signaled = LinuxWaiterFinish(&_waiters, &entry.waiter);
+        _lock.Unlock();
+    }
+    else
+    {
+        // broadcast already happened; we only timed out waiting for our turn on the mutex
+        _lock.Unlock();
+        adaptive->MorphFinish(&entry.waiter);
+        signaled = true;
+    }
+
+    // anyone requeued behind us relies on the mutex staying marked as contended
+    if (adaptive)
+        adaptive->LockContended();
+    else
+        mutex->Lock();
+
+    return signaled ? kStatusOkay : kStatusTimeout;
+}
+
+error_t OConditionVariableImpl::Signal()
+{
+    CHK_DEAD;
+    LinuxWakeQueue wake;
+
+    if (WaitListIsEmpty(&_waiters))
+        return kStatusOkay;
+
+    LinuxWakeQueueInit(&wake);
+
+    _lock.Lock();
+    if (!WaitListIsEmpty(&_waiters))
+        LinuxWakeQueueClaim(&wake, &_waiters, WAIT_LIST_ENTRY(_waiters.head, LinuxWaiter));
+    _lock.Unlock();
+
+    LinuxWakeQueueWake(&wake);
+    return kStatusOkay;
+}
+
+error_t OConditionVariableImpl::Broadcast()
+{
+    CHK_DEAD;
+    LinuxWakeQueue wake;
+    WaitListNode * cur;
+
+    if (WaitListIsEmpty(&_waiters))
+        return kStatusOkay;
+
+    LinuxWakeQueueInit(&wake);
+
+    _lock.Lock();
+    
+    if (WaitListIsEmpty(&_waiters))
+    {
+        _lock.Unlock();
+        return kStatusOkay;
+    }
+
+    if (!_morphTarget)
+    {
+        LinuxWakeQueueClaimAll(&wake, &_waiters);
+        _lock.Unlock();
+
+        LinuxWakeQueueWake(&wake);
+        return kStatusOkay;
+    }
+
+    // wake one to contend for the mutex; everyone else waits on the mutex itself and gets handed it in turn
+    LinuxWakeQueueClaim(&wake, &_waiters, WAIT_LIST_ENTRY(_waiters.head, LinuxWaiter));
+
+    for (cur = _waiters.head; cur; cur = cur->next)
+        WAIT_LIST_ENTRY(cur, ConditionWaiter)->morphed = true;
+
+    _morphTarget->MorphRequeue(&_waiters);
+    _lock.Unlock();
+
+    LinuxWakeQueueWake(&wake);
+    return kStatusOkay;
+}
+
+void OConditionVariableImpl::InvalidateImp()
+{
+    ASSERT(WaitListIsEmpty(&_waiters), "Destroyed condition variable with threads waiting");
+}
+
+error_t Synchronization::CreateConditionVariable(const OOutlivableRef<Synchronization::OConditionVariable> & out)
+{
+    if (!out.PassOwnership(new OConditionVariableImpl()))
+        return kErrorOutOfMemory;
+
+    return kStatusOkay;
+}
@@ -0,0 +1,32 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/Synchronization/OConditionVariable.hpp>
+#include <Core/Synchronization/OSpinlock.hpp>
+#include "WaitList.hpp"
+
+class OAdaptiveMutexImpl;
+
+class OConditionVariableImpl : public Synchronization::OConditionVariable
+{
+public:
+    OConditionVariableImpl();
+
+    error_t Wait(Synchronization::OMutex * mutex, uint32_t ms)        override;
+    error_t WaitUntil(Synchronization::OMutex * mutex, uint64_t deadline) override;
+    error_t Signal()                                                  override;
+    error_t Broadcast()                                               override;
+
+protected:
+    void InvalidateImp()                                              override;
+
+private:
+    Synchronization::Spinlock _lock;    // nests outside of the mutex's wait lock
+    WaitListHead _waiters;
+    OAdaptiveMutexImpl * _morphTarget;  // mutex of the current waiters, if it supports requeueing
+};
+
+LIBLINUX_SYM error_t Synchronization::CreateConditionVariable(const OOutlivableRef<Synchronization::OConditionVariable> & out);
@@ -6,31 +6,289 @@
 #include <libos.hpp>
 #include "OMutex.hpp"
 
+#include <ITypes/IThreadStruct.hpp>
+#include <ITypes/ITask.hpp>
+#include "LinuxSleeping.hpp"
+#include "../../Utils/RCU.hpp"
+
+// upper bound on pause iterations, in case the owner is runnable but preempted
+#define ADAPTIVE_MUTEX_SPIN_MAX 2000
+
 OMutexImpl::OMutexImpl(mutex_k mutex)
 {
-    _mutex = mutex;
+    _mutex      = mutex;
+    _profile    = nullptr;
+    _acquiredAt = 0;
 }
 
 void OMutexImpl::Lock()
 {
+    uint64_t start;
+
+    if (!_profile)
+    {
+        mutex_lock(_mutex);
+        return;
+    }
+
+    start = LockProfileTimestamp();
     mutex_lock(_mutex);
+    _acquiredAt = LockProfileTimestamp();
+
+    LockProfileAcquired(_profile, start, _acquiredAt, (_acquiredAt - start) > LOCK_PROFILE_CONTENDED_NS);
 }
 
 void OMutexImpl::Unlock()
 {
+    if (_profile)
+        LockProfileReleased(_profile, _acquiredAt);
+
     mutex_unlock(_mutex);
 }
 
+Synchronization::MutexMode_e OMutexImpl::GetMode()
+{
+    return Synchronization::kMutexSleeping;
+}
+
+error_t OMutexImpl::EnableProfiling(const char * name)
+{
+    CHK_DEAD;
+    _profile = LockProfileRegister(name);
+    return kStatusOkay;
+}
+
+error_t OMutexImpl::GetStats(Synchronization::MutexStats_t & stats)
+{
+    CHK_DEAD;
+    memset(&stats, 0, sizeof(stats));
+    return kStatusOkay;
+}
+
 void OMutexImpl::InvalidateImp()
 {
     if (_mutex)
         mutex_destroy(_mutex);
 }
 
+OAdaptiveMutexImpl::OAdaptiveMutexImpl()
+{
+    _state             = 0;
+    _owner             = nullptr;
+    _fastAcquisitions  = 0;
+    _spinAcquisitions  = 0;
+    _sleepAcquisitions = 0;
+    _profile           = nullptr;
+    _acquiredAt        = 0;
+    WaitListInit(&_waiters);
+}
+
+bool OAdaptiveMutexImpl::SpinAcquire()
+{
+    bool acquired;
+    task_k owner;
+
+    acquired = false;
+
+    // task_structs are freed after a grace period; hold off reclaim whilst peeking at the owner
+    RCU::ReadLock();
+    for (uint32_t i = 0; i < ADAPTIVE_MUTEX_SPIN_MAX; i++)
+    {
+        if (_state == 0)
+        {
+            if (_InterlockedCompareExchange(&_state, 1, 0) == 0)
+            {
+                acquired = true;
+                break;
+            }
+            continue;
+        }
+
+        // a preempted owner is still TASK_RUNNING but can't make progress; only spin while it's actually on a CPU (task_struct::on_cpu)
+        owner = _owner;
+        if (owner && !ITask(owner).GetVarOnCPU().GetUInt())
+            break;
+
+        SPINLOOP_PROCYIELD();
+    }
+    RCU::ReadUnlock();
+
+    return acquired;
+}
+
+void OAdaptiveMutexImpl::SleepAcquire()
+{
+    while (true)
+    {
+        LinuxWaiter entry;
+
+        _waitLock.Lock();
+
+        // mark contended; if it was free we now own it
+        if (_InterlockedExchange(&_state, 2) == 0)
+        {
+            _waitLock.Unlock();
+            return;
+        }
+
+        LinuxWaiterInit(&entry);
+        LinuxWaiterEnqueue(&_waiters, &entry);
+        _waitLock.Unlock();
+
+        // can't give up on a signal, and a dying task contending on de_critical_section has one pending
+        LinuxSleepDeadlineUninterruptible(LINUX_SLEEP_INFINITE, LinuxWaiterIsSignaled, &entry);
+
+        _waitLock.Lock();
+        LinuxWaiterFinish(&_waiters, &entry);
+        _waitLock.Unlock();
+    }
+}
+
+void OAdaptiveMutexImpl::Lock()
+{
+    uint64_t start;
+
+    if (_InterlockedCompareExchange(&_state, 1, 0) == 0)
+    {
+        _owner = OSThread;
+        _fastAcquisitions++;
+
+        if (_profile)
+        {
+            _acquiredAt = LockProfileTimestamp();
+            LockProfileAcquired(_profile, _acquiredAt, _acquiredAt, false);
+        }
+        return;
+    }
+
+    start = _profile ? LockProfileTimestamp() : 0;
+
+    if (SpinAcquire())
+    {
+        _owner = OSThread;
+        _spinAcquisitions++;
+    }
+    else
+    {
+        SleepAcquire();
+        _owner = OSThread;
+        _sleepAcquisitions++;
+    }
+
+    if (_profile)
+    {
+        _acquiredAt = LockProfileTimestamp();
+        LockProfileAcquired(_profile, start, _acquiredAt, true);
+    }
+}
+
+void OAdaptiveMutexImpl::Unlock()
+{
+    LinuxWakeQueue wake;
+
+    if (_profile)
+        LockProfileReleased(_profile, _acquiredAt);
+
+    _owner = nullptr;
+
+    if (_InterlockedExchange(&_state, 0) != 2)
+        return;
+
+    LinuxWakeQueueInit(&wake);
+
+    _waitLock.Lock();
+    if (!WaitListIsEmpty(&_waiters))
+        LinuxWakeQueueClaim(&wake, &_waiters, WAIT_LIST_ENTRY(_waiters.head, LinuxWaiter));
+    _waitLock.Unlock();
+
+    LinuxWakeQueueWake(&wake);
+}
+
+void OAdaptiveMutexImpl::LockContended()
+{
+    uint64_t start;
+
+    start = _profile ? LockProfileTimestamp() : 0;
+
+    SleepAcquire();
+    _owner = OSThread;
+    _sleepAcquisitions++;
+
+    if (_profile)
+    {
+        _acquiredAt = LockProfileTimestamp();
+        LockProfileAcquired(_profile, start, _acquiredAt, true);
+    }
+}
+
+void OAdaptiveMutexImpl::MorphRequeue(WaitListHead * waiters)
+{
+    long state;
+
+    _waitLock.Lock();
+
+    while (!WaitListIsEmpty(waiters))
+        WaitListAppend(&_waiters, WaitListPopFront(waiters));
+
+    // make sure the current owner's Unlock takes the slow path. if nobody owns it, the next LockContended marks it instead
+    while (((state = _state) == 1) && (_InterlockedCompareExchange(&_state, 2, 1) != 1));
+
+    _waitLock.Unlock();
+}
+
+void OAdaptiveMutexImpl::MorphFinish(LinuxWaiter * waiter)
+{
+    _waitLock.Lock();
+    LinuxWaiterFinish(&_waiters, waiter);
+    _waitLock.Unlock();
+}
+
+Synchronization::MutexMode_e OAdaptiveMutexImpl::GetMode()
+{
+    return Synchronization::kMutexAdaptive;
+}
+
+error_t OAdaptiveMutexImpl::GetStats(Synchronization::MutexStats_t & stats)
+{
+    CHK_DEAD;
+    stats.fastAcquisitions  = _fastAcquisitions;
+    stats.spinAcquisitions  = _spinAcquisitions;
+    stats.sleepAcquisitions = _sleepAcquisitions;
+    return kStatusOkay;
+}
+
+error_t OAdaptiveMutexImpl::EnableProfiling(const char * name)
+{
+    CHK_DEAD;
+    _profile = LockProfileRegister(name);
+    return kStatusOkay;
+}
+
+void OAdaptiveMutexImpl::InvalidateImp()
+{
+    ASSERT(_state == 0, "Destroyed adaptive mutex whilst it was held");
+}
+
 error_t Synchronization::CreateMutex(const OOutlivableRef<Synchronization::OMutex> & out)
+{
+    return CreateMutex(kMutexSleeping, out);
+}
+
+error_t Synchronization::CreateMutex(Synchronization::MutexMode_e mode, const OOutlivableRef<Synchronization::OMutex> & out)
 {
     mutex_k mutex;
 
+    if (mode == kMutexAdaptive)
+    {
+        if (!(out.PassOwnership(new OAdaptiveMutexImpl())))
+            return kErrorOutOfMemory;
+
+        return kStatusOkay;
+    }
+
+    if (mode != kMutexSleeping)
+        return kErrorIllegalBadArgument;
+
     mutex = mutex_init();
 
     if (!mutex)
@@ -5,6 +5,11 @@
 */
 #pragma once
 #include <Core/Synchronization/OMutex.hpp>
+#include <Core/Synchronization/OSpinlock.hpp>
+#include "WaitList.hpp"
+#include "LockProfiler.hpp"
+
+struct LinuxWaiter;
 
 class OMutexImpl : public Synchronization::OMutex
 {
@@ -13,12 +18,57 @@ public:
 
     void Lock()          override;
     void Unlock()        override;
+    Synchronization::MutexMode_e GetMode() override;
+
+    error_t GetStats(Synchronization::MutexStats_t & stats) override;
+    error_t EnableProfiling(const char * name)              override;
 
 private:
     void InvalidateImp() override;
 
 private:
     mutex_k _mutex;
+    LockProfile * _profile;
+    uint64_t _acquiredAt;
 };
 
+class OAdaptiveMutexImpl : public Synchronization::OMutex
+{
+public:
+    OAdaptiveMutexImpl();
+
+    void Lock()          override;
+    void Unlock()        override;
+    Synchronization::MutexMode_e GetMode() override;
+
+    error_t GetStats(Synchronization::MutexStats_t & stats) override;
+    error_t EnableProfiling(const char * name)              override;
+
+    // wait morphing (OConditionVariable)
+    void LockContended();                       // acquire, leaving the lock marked as contended for requeued waiters
+    void MorphRequeue(WaitListHead * waiters);  // steal parked LinuxWaiters; they're handed the lock one at a time by Unlock
+    void MorphFinish(LinuxWaiter * waiter);     // LinuxWaiterFinish for a requeued waiter
+
+private:
+    void InvalidateImp() override;
+
+    bool SpinAcquire();
+    void SleepAcquire();
+
+private:
+    volatile long _state;               // 0 = unlocked, 1 = locked, 2 = locked and threads may be sleeping
+    task_k volatile _owner;             // hint for the spin phase, only valid under RCU
+    Synchronization::Spinlock _waitLock;
+    WaitListHead _waiters;
+
+    // only ever touched by the owner
+    uint64_t _fastAcquisitions;
+    uint64_t _spinAcquisitions;
+    uint64_t _sleepAcquisitions;
+
+    LockProfile * _profile;
+    uint64_t _acquiredAt;
+};
+
 LIBLINUX_SYM error_t Synchronization::CreateMutex(const OOutlivableRef<Synchronization::OMutex> & out);
+LIBLINUX_SYM error_t Synchronization::CreateMutex(Synchronization::MutexMode_e mode, const OOutlivableRef<Synchronization::OMutex> & out);
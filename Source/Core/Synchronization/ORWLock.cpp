@@ -0,0 +1,275 @@
+/*
+    Purpose: Sleeping reader/writer lock with an atomic fast path
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "ORWLock.hpp"
+
+#include <Utils/DateHelper.hpp>
+#include "LinuxSleeping.hpp"
+
+#define RWLOCK_WRITER 0x40000000
+
+ORWLockImpl::ORWLockImpl(bool writerPreference)
+{
+    _state            = 0;
+    _writersWaiting   = 0;
+    _sleepers         = 0;
+    _writerPreference = writerPreference;
+    WaitListInit(&_readers);
+    WaitListInit(&_writers);
+    _profile          = nullptr;
+    _writeAcquiredAt  = 0;
+}
+
+void ORWLockImpl::ProfileAcquired(bool write, uint64_t start, bool contended)
+{
+    uint64_t now;
+
+    now = LockProfileTimestamp();
+    LockProfileAcquired(_profile, start ? start : now, now, contended);
+
+    if (write)
+        _writeAcquiredAt = now;
+}
+
+bool ORWLockImpl::TryAcquireRead()
+{
+    long state;
+
+    while (true)
+    {
+        state = _state;
+
+        if (state & RWLOCK_WRITER)
+            return false;
+
+        if (_writerPreference && _writersWaiting)
+            return false;
+
+        if (_InterlockedCompareExchange(&_state, state + 1, state) == state)
+            return true;
+    }
+}
+
+bool ORWLockImpl::TryAcquireWrite()
+{
+    return _InterlockedCompareExchange(&_state, RWLOCK_WRITER, 0) == 0;
+}
+
+bool ORWLockImpl::TryAcquire(bool write)
+{
+    return write ? TryAcquireWrite() : TryAcquireRead();
+}
+
+void ORWLockImpl::WakeWaiters()
+{
+    LinuxWakeQueue wake;
+
+    LinuxWakeQueueInit(&wake);
+
+    _lock.Lock();
+    {
+        // woken threads retry the fast path; losers simply go back to sleep
+        if (!WaitListIsEmpty(&_writers) && (_writerPreference || WaitListIsEmpty(&_readers)))
+            LinuxWakeQueueClaim(&wake, &_writers, WAIT_LIST_ENTRY(_writers.head, LinuxWaiter));
+        else
+            LinuxWakeQueueClaimAll(&wake, &_readers);
+    }
+    _lock.Unlock();
+
+    LinuxWakeQueueWake(&wake);
+}
+
+bool ORWLockImpl::SlowLock(bool write, uint32_t ms)
+{
+    WaitListHead * list;
+    uint64_t deadline;
+    bool acquired;
+
+    list     = write ? &_writers : &_readers;
+    deadline = LinuxSleepDeadlineFromMS(ms);
+    acquired = false;
+
+    if (write)
+        _InterlockedIncrement(&_writersWaiting);
+
+    while (true)
+    {
+        LinuxWaiter entry;
+
+        _lock.Lock();
+
+        // unlockers release _state before checking _sleepers; we do the opposite
+        _InterlockedIncrement(&_sleepers);
+
+        if (TryAcquire(write))
+        {
+            _InterlockedDecrement(&_sleepers);
+            _lock.Unlock();
+            acquired = true;
+            break;
+        }
+
+        if ((deadline != LINUX_SLEEP_INFINITE) && (DateHelpers::GetBootTime() >= deadline))
+        {
+            _InterlockedDecrement(&_sleepers);
+            _lock.Unlock();
+            break;
+        }
+
+        LinuxWaiterInit(&entry);
+        LinuxWaiterEnqueue(list, &entry);
+        _lock.Unlock();
+
+        // same as the mutex: exiting tasks take read locks (tracking_hooks) with a signal pending
+        LinuxSleepDeadlineUninterruptible(deadline, LinuxWaiterIsSignaled, &entry);
+
+        _lock.Lock();
+        LinuxWaiterFinish(list, &entry);
+        _InterlockedDecrement(&_sleepers);
+        _lock.Unlock();
+    }
+
+    if (write)
+    {
+        // a writer giving up may have been the only thing holding back sleeping readers
+        if ((_InterlockedDecrement(&_writersWaiting) == 0) && !acquired && _sleepers)
+            WakeWaiters();
+    }
+
+    return acquired;
+}
+
+void ORWLockImpl::ReadLock()
+{
+    CHK_DEAD_RET_VOID;
+
+    uint64_t start;
+
+    if (TryAcquireRead())
+    {
+        if (_profile)
+            ProfileAcquired(false, 0, false);
+        return;
+    }
+
+    start = _profile ? LockProfileTimestamp() : 0;
+    SlowLock(false, -1);
+
+    if (_profile)
+        ProfileAcquired(false, start, true);
+}
+
+void ORWLockImpl::ReadUnlock()
+{
+    CHK_DEAD_RET_VOID;
+
+    if ((_InterlockedDecrement(&_state) == 0) && _sleepers)
+        WakeWaiters();
+}
+
+void ORWLockImpl::WriteLock()
+{
+    CHK_DEAD_RET_VOID;
+
+    uint64_t start;
+
+    if (TryAcquireWrite())
+    {
+        if (_profile)
+            ProfileAcquired(true, 0, false);
+        return;
+    }
+
+    start = _profile ? LockProfileTimestamp() : 0;
+    SlowLock(true, -1);
+
+    if (_profile)
+        ProfileAcquired(true, start, true);
+}
+
+void ORWLockImpl::WriteUnlock()
+{
+    CHK_DEAD_RET_VOID;
+
+    if (_profile)
+        LockProfileReleased(_profile, _writeAcquiredAt);
+
+    _InterlockedExchangeAdd(&_state, -RWLOCK_WRITER);
+
+    if (_sleepers)
+        WakeWaiters();
+}
+
+error_t ORWLockImpl::TryReadLock(uint32_t ms)
+{
+    CHK_DEAD;
+    uint64_t start;
+
+    if (TryAcquireRead())
+    {
+        if (_profile)
+            ProfileAcquired(false, 0, false);
+        return kStatusOkay;
+    }
+
+    if (ms == 0)
+        return kStatusTimeout;
+
+    start = _profile ? LockProfileTimestamp() : 0;
+
+    if (!SlowLock(false, ms))
+        return kStatusTimeout;
+
+    if (_profile)
+        ProfileAcquired(false, start, true);
+    return kStatusOkay;
+}
+
+error_t ORWLockImpl::TryWriteLock(uint32_t ms)
+{
+    CHK_DEAD;
+    uint64_t start;
+
+    if (TryAcquireWrite())
+    {
+        if (_profile)
+            ProfileAcquired(true, 0, false);
+        return kStatusOkay;
+    }
+
+    if (ms == 0)
+        return kStatusTimeout;
+
+    start = _profile ? LockProfileTimestamp() : 0;
+
+    if (!SlowLock(true, ms))
+        return kStatusTimeout;
+
+    if (_profile)
+        ProfileAcquired(true, start, true);
+    return kStatusOkay;
+}
+
+error_t ORWLockImpl::EnableProfiling(const char * name)
+{
+    CHK_DEAD;
+    _profile = LockProfileRegister(name);
+    return kStatusOkay;
+}
+
+void ORWLockImpl::InvalidateImp()
+{
+    ASSERT(_state == 0, "Destroyed reader/writer lock whilst it was held");
+    ASSERT(WaitListIsEmpty(&_readers) && WaitListIsEmpty(&_writers), "Destroyed reader/writer lock with threads waiting");
+}
+
+error_t Synchronization::CreateRWLock(bool writerPreference, const OOutlivableRef<Synchronization::ORWLock> & out)
+{
+    if (!out.PassOwnership(new ORWLockImpl(writerPreference)))
+        return kErrorOutOfMemory;
+
+    return kStatusOkay;
+}
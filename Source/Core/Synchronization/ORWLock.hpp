@@ -0,0 +1,52 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/Synchronization/ORWLock.hpp>
+#include <Core/Synchronization/OSpinlock.hpp>
+#include "WaitList.hpp"
+#include "LockProfiler.hpp"
+
+class ORWLockImpl : public Synchronization::ORWLock
+{
+public:
+    ORWLockImpl(bool writerPreference);
+
+    void    ReadLock()                override;
+    void    ReadUnlock()              override;
+
+    void    WriteLock()               override;
+    void    WriteUnlock()             override;
+
+    error_t TryReadLock(uint32_t ms)  override;
+    error_t TryWriteLock(uint32_t ms) override;
+
+    error_t EnableProfiling(const char * name) override;
+
+protected:
+    void InvalidateImp()              override;
+
+private:
+    bool    TryAcquireRead();
+    bool    TryAcquireWrite();
+    bool    TryAcquire(bool write);
+    bool    SlowLock(bool write, uint32_t ms);
+    void    WakeWaiters();
+    void    ProfileAcquired(bool write, uint64_t start, bool contended);
+
+    volatile long _state;           // reader count | RWLOCK_WRITER
+    volatile long _writersWaiting;  // writers in the slow path
+    volatile long _sleepers;        // threads in the slow path of any kind
+    bool _writerPreference;
+
+    Synchronization::Spinlock _lock; // protects the wait lists
+    WaitListHead _readers;
+    WaitListHead _writers;
+
+    LockProfile * _profile;
+    uint64_t _writeAcquiredAt;
+};
+
+LIBLINUX_SYM error_t Synchronization::CreateRWLock(bool writerPreference, const OOutlivableRef<Synchronization::ORWLock> & out);
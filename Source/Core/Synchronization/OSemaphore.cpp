@@ -11,113 +11,179 @@
 #include <Utils/DateHelper.hpp>
 
 #include "LinuxSleeping.hpp"
+#include "OWaitable.hpp"
 
-struct SemaWaitingThreads
+struct SemaphoreWaiter
 {
-    task_k thread;
-    volatile bool signal;
+    LinuxWaiter waiter;
+    uint32_t count;     // units handed over in one go by ContExecution
 };
 
-OCountingSemaphoreImpl::OCountingSemaphoreImpl(uint32_t startCount, mutex_k mutex, dyn_list_head_p list)
+OCountingSemaphoreImpl::OCountingSemaphoreImpl(uint32_t startCount, Synchronization::WakePolicy_e policy, mutex_k mutex)
 {
     _counter     = startCount;
+    _waiting     = 0;
+    _queued      = 0;
     _acquisition = mutex;
-    _list        = list;
+    WaitListInit(&_waiters);
+    WaitListInit(&_observers);
+    _profile     = nullptr;
+    _policy      = policy;
+    _stats       = { 0 };
+}
+
+bool OCountingSemaphoreImpl::TryAcquire(uint32_t count)
+{
+    long counter;
+
+    while ((counter = _counter) >= long(count))
+    {
+        if (_InterlockedCompareExchange(&_counter, counter - long(count), counter) == counter)
+            return true;
+    }
+
+    return false;
+}
+
+bool OCountingSemaphoreImpl::TryAcquireFast(uint32_t count)
+{
+    // never barge past queued requests, otherwise a stream of small acquires starves a large one
+    if (_queued)
+        return false;
+
+    return TryAcquire(count);
 }
 
 error_t OCountingSemaphoreImpl::Wait(uint32_t ms)
 {
     CHK_DEAD;
-    error_t err;
+    return Wait(1, ms);
+}
 
-    mutex_lock(_acquisition);
+error_t OCountingSemaphoreImpl::Wait(uint32_t count, uint32_t ms)
+{
+    CHK_DEAD;
+
+    if (!count)
+        return kErrorIllegalBadArgument;
+
+    if (count > INT32_MAX)
+        return kErrorIllegalSize;
+
+    // don't bother reading the clock if we aren't going to sleep
+    if (TryAcquireFast(count))
     {
-        if (_counter > 0)
+        if (_profile)
         {
-            _counter--;
-
-            err = kStatusSemaphoreAlreadyUnlocked;
-            goto out;
+            uint64_t now = LockProfileTimestamp();
+            LockProfileAcquired(_profile, now, now, false);
         }
-
-        err = GoToSleep(ms);
+        return kStatusSemaphoreAlreadyUnlocked;
     }
-    out:
-    mutex_unlock(_acquisition);
 
-    return err;
+    return WaitUntil(count, LinuxSleepDeadlineFromMS(ms));
 }
 
-static bool SemaphoreIsWaking(void * context)
+error_t OCountingSemaphoreImpl::WaitUntil(uint64_t deadline)
 {
-    return reinterpret_cast<SemaWaitingThreads *>(context)->signal;
+    CHK_DEAD;
+    return WaitUntil(1, deadline);
 }
 
-error_t OCountingSemaphoreImpl::NewThreadContext(SemaWaitingThreads * context)
+error_t OCountingSemaphoreImpl::WaitUntil(uint32_t count, uint64_t deadline)
 {
+    CHK_DEAD;
     error_t err;
-    SemaWaitingThreads **lentry;
+    uint64_t start;
+    LinuxWakeQueue wake;
 
-    context->thread = OSThread;
-    context->signal = false;
+    if (!count)
+        return kErrorIllegalBadArgument;
 
-    err = dyn_list_append_ex(_list, reinterpret_cast<void**>(&lentry), nullptr);
-    if (ERROR(err))
-        return err;
+    if (count > INT32_MAX)
+        return kErrorIllegalSize;
 
-    *lentry = context;
+    start = _profile ? LockProfileTimestamp() : 0;
 
-    return kStatusOkay;
+    // uncontended: no lock, no list
+    if (TryAcquireFast(count))
+    {
+        if (_profile)
+            LockProfileAcquired(_profile, start, start, false);
+        return kStatusSemaphoreAlreadyUnlocked;
+    }
+
+    LinuxWakeQueueInit(&wake);
+
+    mutex_lock(_acquisition);
+    {
+        // announce ourselves before re-checking the counter; Trigger adds to the counter before checking _waiting
+        _InterlockedIncrement(&_waiting);
+
+        // only the head of the queue may take units directly
+        if (WaitListIsEmpty(&_waiters) && TryAcquire(count))
+            err = kStatusSemaphoreAlreadyUnlocked;
+        else
+            err = GoToSleep(count, deadline, &wake);
+
+        _InterlockedDecrement(&_waiting);
+    }
+    mutex_unlock(_acquisition);
+
+    LinuxWakeQueueWake(&wake);
+
+    if (_profile && (err != kStatusTimeout))
+        LockProfileAcquired(_profile, start, LockProfileTimestamp(), err == kStatusOkay);
+
+    return err;
 }
 
-error_t OCountingSemaphoreImpl::GoToSleep(uint32_t ms)
+error_t OCountingSemaphoreImpl::GoToSleep(uint32_t count, uint64_t deadline, LinuxWakeQueue * queue)
 {
     CHK_DEAD;
-    error_t err;
     bool signald;
-    SemaWaitingThreads entry;
+    uint32_t ignored;
+    SemaphoreWaiter entry;
 
     // create new context
-    err = NewThreadContext(&entry);
-    if (ERROR(err))
-        return err;
+    LinuxWaiterInit(&entry.waiter);
+    entry.count = count;
+    LinuxWaiterEnqueue(&_waiters, &entry.waiter);
+    _InterlockedIncrement(&_queued);
 
     // go to sleep 
     mutex_unlock(_acquisition);
-    signald = LinuxSleep(ms, SemaphoreIsWaking, &entry);
+    LinuxSleepDeadline(deadline, LinuxWaiterIsSignaled, &entry.waiter);
     mutex_lock(_acquisition);
 
+    // a trigger may have handed us our units between timing out and reacquiring the mutex
+    signald = LinuxWaiterFinish(&_waiters, &entry.waiter);
+    _InterlockedDecrement(&_queued);
+
+    // we may have been the request holding up everyone behind us
+    if (!signald)
+        ContExecution(queue, ignored);
+
     return !signald ? kStatusTimeout  : kStatusOkay;
 }
 
-error_t OCountingSemaphoreImpl::ContExecution(uint32_t count, uint32_t & threadsCont)
+error_t OCountingSemaphoreImpl::ContExecution(LinuxWakeQueue * queue, uint32_t & threadsCont)
 {
-    error_t err;
-    SemaWaitingThreads **entry;
-    size_t entries;
-    size_t threads;
-
-    threadsCont = 0;
+    uint32_t threads;
+    SemaphoreWaiter * next;
 
-    err = dyn_list_entries(_list, &entries);
-    if (ERROR(err))
-        return err;
+    threads = 0;
 
-    threads = MIN(count, entries);
-
-    for (size_t i = 0; i < threads; i++)
+    // hand each waiter its units, in policy order, stopping at the first request we can't fully satisfy so that it isn't starved
+    while (!WaitListIsEmpty(&_waiters))
     {
-        task_k thread;
-
-        err = dyn_list_get_by_index(_list, 0, reinterpret_cast<void**>(&entry));
-        ASSERT(NO_ERROR(err), "couldn't obtain waiting thread by index (error: " PRINTF_ERROR ")", err);
+        next = reinterpret_cast<SemaphoreWaiter *>(LinuxWaiterPick(&_waiters, _policy));
 
-        thread = (*entry)->thread;
-        (*entry)->signal = true;
-        LinuxPokeThread(thread);
+        if (!TryAcquire(next->count))
+            break;
 
-        err = dyn_list_remove(_list, 0);
-        ASSERT(NO_ERROR(err), "couldn't remove thread by index (error: " PRINTF_ERROR ")", err);
+        LinuxWakeQueueClaimPolicy(queue, &_waiters, &next->waiter, &_stats);
+        threads++;
     }
 
     threadsCont = threads;
@@ -128,62 +194,119 @@ error_t OCountingSemaphoreImpl::Trigger(uint32_t count, uint32_t & releasedThrea
 {
     CHK_DEAD;
     uint32_t signals;
+    LinuxWakeQueue wake;
 
-    mutex_lock(_acquisition);
+    _InterlockedExchangeAdd(&_counter, long(count));
+
+    // nobody is parked - waiters increment _waiting before their final check of the counter
+    if (!_waiting)
     {
-        ContExecution(count, signals);
+        releasedThreads = 0;
+        debt = _counter;
+        return kStatusOkay;
+    }
 
-        releasedThreads = signals;
+    LinuxWakeQueueInit(&wake);
+
+    mutex_lock(_acquisition);
+    {
+        ContExecution(&wake, signals);
 
-        if (signals != count)
-            _counter += count - releasedThreads;
+        // whatever is left over is up for grabs by WaitMultiple callers
+        if ((_counter > 0) && !WaitListIsEmpty(&_observers))
+            WaitableNotifyObservers(&_observers);
 
+        releasedThreads = signals;
         debt = _counter;
     }
     mutex_unlock(_acquisition); 
 
+    LinuxWakeQueueWake(&wake);
+
     return kStatusOkay;
 }
 
-void OCountingSemaphoreImpl::InvalidateImp()
+error_t OCountingSemaphoreImpl::EnableProfiling(const char * name)
 {
-    error_t err;
-    size_t waiters;
+    CHK_DEAD;
+    _profile = LockProfileRegister(name);
+    return kStatusOkay;
+}
+
+error_t OCountingSemaphoreImpl::GetWakeStats(Synchronization::WakeStats_t & stats)
+{
+    CHK_DEAD;
+
+    mutex_lock(_acquisition);
+    stats.wakes      = _stats.wakes;
+    stats.localWakes = _stats.localWakes;
+    mutex_unlock(_acquisition);
+
+    return kStatusOkay;
+}
+
+bool OCountingSemaphoreImpl::WaitableIsSignaled()
+{
+    return _counter > 0;
+}
 
-    err = dyn_list_entries(_list, &waiters);
-    ASSERT(NO_ERROR(err), "couldn't obtain length of waiters (error: " PRINTF_ERROR ")", err);
+bool OCountingSemaphoreImpl::WaitableTryAcquire()
+{
+    return TryAcquireFast(1);
+}
+
+void OCountingSemaphoreImpl::WaitableRelease()
+{
+    uint32_t released;
+    uint32_t debt;
+
+    Trigger(1, released, debt);
+}
+
+void OCountingSemaphoreImpl::WaitableAddObserver(Synchronization::WaitableObserver * observer)
+{
+    mutex_lock(_acquisition);
+    // counts as waiting so that Trigger doesn't skip the slow path
+    _InterlockedIncrement(&_waiting);
+    WaitListAppend(&_observers, &observer->node);
+    mutex_unlock(_acquisition);
+}
+
+void OCountingSemaphoreImpl::WaitableRemoveObserver(Synchronization::WaitableObserver * observer)
+{
+    mutex_lock(_acquisition);
+    WaitListRemove(&_observers, &observer->node);
+    _InterlockedDecrement(&_waiting);
+    mutex_unlock(_acquisition);
+}
 
-    ASSERT(waiters == 0, "Destroyed counting semaphore with items awaiting");
+void OCountingSemaphoreImpl::InvalidateImp()
+{
+    ASSERT(WaitListIsEmpty(&_waiters), "Destroyed counting semaphore with items awaiting");
+    ASSERT(WaitListIsEmpty(&_observers), "Destroyed counting semaphore with WaitMultiple observers");
 
-    dyn_list_destroy(_list);
     mutex_destroy(_acquisition);
 }
 
 error_t Synchronization::CreateCountingSemaphore(size_t count, const OOutlivableRef<Synchronization::OCountingSemaphore> out)
 {
-    dyn_list_head_p list;
+    return CreateCountingSemaphore(count, kWakeFifo, out);
+}
+
+error_t Synchronization::CreateCountingSemaphore(size_t count, Synchronization::WakePolicy_e policy, const OOutlivableRef<Synchronization::OCountingSemaphore> out)
+{
     mutex_k mutex;
-    OSimpleSemaphore * sema;
 
     if (count > UINT32_MAX)
         return kErrorIllegalSize;
 
-    list = DYN_LIST_CREATE(SemaWaitingThreads*);
-
-    if (!list)
-        return kErrorOutOfMemory;
-
     mutex = mutex_init();
 
     if (!mutex)
-    {
-        dyn_list_destroy(list);
         return kErrorOutOfMemory;
-    }
 
-    if (!out.PassOwnership(new OCountingSemaphoreImpl(count, mutex, list)))
+    if (!out.PassOwnership(new OCountingSemaphoreImpl(count, policy, mutex)))
     {
-        dyn_list_destroy(list);
         mutex_destroy(mutex);
         return kErrorOutOfMemory;
     }
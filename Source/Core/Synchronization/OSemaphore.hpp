@@ -4,28 +4,48 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #include <Core/Synchronization/OSemaphore.hpp>
+#include "LinuxSleeping.hpp"
+#include "LockProfiler.hpp"
 
 class OSimpleSemaphore;
-struct SemaWaitingThreads;
 
 class OCountingSemaphoreImpl : public Synchronization::OCountingSemaphore
 {
 public:
-    OCountingSemaphoreImpl(uint32_t start_count, mutex_k mutex, dyn_list_head_p list);
+    OCountingSemaphoreImpl(uint32_t start_count, Synchronization::WakePolicy_e policy, mutex_k mutex);
     error_t Wait(uint32_t ms)                                                    override;
+    error_t Wait(uint32_t count, uint32_t ms)                                    override;
+    error_t WaitUntil(uint64_t deadline)                                         override;
+    error_t WaitUntil(uint32_t count, uint64_t deadline)                         override;
     error_t Trigger(uint32_t count, uint32_t & releasedThreads, uint32_t & debt) override;
+    error_t EnableProfiling(const char * name)                                   override;
+    error_t GetWakeStats(Synchronization::WakeStats_t & stats)                   override;
+
+    bool WaitableIsSignaled()                                                    override;
+    bool WaitableTryAcquire()                                                    override;
+    void WaitableRelease()                                                       override;
+    void WaitableAddObserver(Synchronization::WaitableObserver * observer)       override;
+    void WaitableRemoveObserver(Synchronization::WaitableObserver * observer)    override;
 
 protected:
     void InvalidateImp()                                                         override;
 
 private:
-    error_t GoToSleep(uint32_t ms);
-    error_t NewThreadContext(SemaWaitingThreads * context);
-    error_t ContExecution(uint32_t count, uint32_t & threadsCont);
+    bool    TryAcquire(uint32_t count);
+    bool    TryAcquireFast(uint32_t count);
+    error_t GoToSleep(uint32_t count, uint64_t deadline, LinuxWakeQueue * queue);
+    error_t ContExecution(LinuxWakeQueue * queue, uint32_t & threadsCont);
 
     mutex_k _acquisition;
     volatile long _counter;
-    dyn_list_head_p _list;
+    volatile long _waiting;     // sleepers + WaitMultiple observers
+    volatile long _queued;      // sleepers only; fast paths back off whilst non-zero
+    WaitListHead _waiters;
+    WaitListHead _observers;
+    LockProfile * _profile;
+    Synchronization::WakePolicy_e _policy;
+    LinuxWakeStats _stats;
 };
 
 LIBLINUX_SYM error_t Synchronization::CreateCountingSemaphore(size_t count, const OOutlivableRef<Synchronization::OCountingSemaphore> out);
+LIBLINUX_SYM error_t Synchronization::CreateCountingSemaphore(size_t count, Synchronization::WakePolicy_e policy, const OOutlivableRef<Synchronization::OCountingSemaphore> out);
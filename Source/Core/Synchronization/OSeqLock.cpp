@@ -0,0 +1,51 @@
+/*
+    Purpose: Sequence lock - spinlock serialized writers, lock-free retrying readers
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "OSeqLock.hpp"
+
+Synchronization::OSeqLock::OSeqLock() : _sequence(0)
+{}
+
+uint32_t Synchronization::OSeqLock::ReadBegin()
+{
+    uint32_t seq;
+
+    while ((seq = uint32_t(_sequence)) & 1)
+    {
+        SPINLOOP_PROCYIELD();
+    }
+
+    // x86 doesn't reorder loads with loads; we only need the compiler to keep the protected reads after this one
+    _ReadWriteBarrier();
+    return seq;
+}
+
+bool Synchronization::OSeqLock::ReadRetry(uint32_t seq)
+{
+    _ReadWriteBarrier();
+    return uint32_t(_sequence) != seq;
+}
+
+void Synchronization::OSeqLock::WriteLock()
+{
+    _writer.Lock();
+    _InterlockedIncrement(&_sequence);
+}
+
+bool Synchronization::OSeqLock::TryWriteLock()
+{
+    if (!_writer.TryLock())
+        return false;
+
+    _InterlockedIncrement(&_sequence);
+    return true;
+}
+
+void Synchronization::OSeqLock::WriteUnlock()
+{
+    _InterlockedIncrement(&_sequence);
+    _writer.Unlock();
+}
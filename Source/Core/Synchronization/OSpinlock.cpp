@@ -5,27 +5,182 @@
 */  
 #include <libos.hpp>
 #include "OSpinlock.hpp"
+#include "LockProfiler.hpp"
 
-Synchronization::Spinlock::Spinlock() : _value(0) 
+Synchronization::Spinlock::Spinlock() : _value(0), _contention(0), _profile(nullptr), _acquiredAt(0)
 {}
+
+void Synchronization::Spinlock::ProfileAcquired(uint64_t start, bool contended)
+{
+    _acquiredAt = LockProfileTimestamp();
+    LockProfileAcquired(_profile, start ? start : _acquiredAt, _acquiredAt, contended);
+}
 
 void Synchronization::Spinlock::Lock()
 {
-    while (_interlockedbittestandset(&_value, 0))
+    uint64_t start;
+
+    if (!_interlockedbittestandset(&_value, 0))
+    {
+        if (_profile)
+            ProfileAcquired(0, false);
+        return;
+    }
+
+    _InterlockedIncrement(&_contention);
+    start = _profile ? LockProfileTimestamp() : 0;
+
+    do
     {
         while (_value)
         {
             SPINLOOP_PROCYIELD();
         }
-    }
+    } while (_interlockedbittestandset(&_value, 0));
+
+    if (_profile)
+        ProfileAcquired(start, true);
+}
+
+bool Synchronization::Spinlock::TryLock()
+{
+    if (_value)
+        return false;
+
+    if (_interlockedbittestandset(&_value, 0))
+        return false;
+
+    if (_profile)
+        ProfileAcquired(0, false);
+
+    return true;
 }
 
 void Synchronization::Spinlock::Unlock()
 {
+    if (_profile)
+        LockProfileReleased(_profile, _acquiredAt);
+
     _value = 0;
+}
+
+void Synchronization::Spinlock::EnableProfiling(const char * name)
+{
+    _profile = LockProfileRegister(name);
 }
 
 bool Synchronization::Spinlock::IsLocked()
 {
     return _value ? true : false;
 }
+
+long Synchronization::Spinlock::GetContention()
+{
+    return _contention;
+}
+
+Synchronization::TicketSpinlock::TicketSpinlock() : _next(0), _serving(0), _contention(0)
+{}
+
+void Synchronization::TicketSpinlock::Lock()
+{
+    long ticket;
+    long distance;
+
+    ticket = _InterlockedExchangeAdd(&_next, 1);
+
+    if (_serving == ticket)
+        return;
+
+    _InterlockedIncrement(&_contention);
+
+    while ((distance = ticket - _serving) != 0)
+    {
+        // don't keep pulling the line into our cache when we're nowhere near the front
+        for (long i = 0; i < distance * SPINLOOP_TICKET_BACKOFF; i++)
+            SPINLOOP_PROCYIELD();
+    }
+}
+
+bool Synchronization::TicketSpinlock::TryLock()
+{
+    long serving;
+
+    // _serving never passes _next, so if _next still equals our snapshot the lock was free
+    serving = _serving;
+    return _InterlockedCompareExchange(&_next, serving + 1, serving) == serving;
+}
+
+void Synchronization::TicketSpinlock::Unlock()
+{
+    _InterlockedIncrement(&_serving);
+}
+
+bool Synchronization::TicketSpinlock::IsLocked()
+{
+    return _next != _serving;
+}
+
+long Synchronization::TicketSpinlock::GetContention()
+{
+    return _contention;
+}
+
+Synchronization::QueuedSpinlock::QueuedSpinlock() : _tail(nullptr), _contention(0)
+{}
+
+void Synchronization::QueuedSpinlock::Lock(QueuedSpinlockNode & node)
+{
+    QueuedSpinlockNode * prev;
+
+    node.next   = nullptr;
+    node.locked = 1;
+
+    prev = reinterpret_cast<QueuedSpinlockNode *>(_InterlockedExchangePointer(reinterpret_cast<void * volatile *>(&_tail), &node));
+    if (!prev)
+        return;
+
+    _InterlockedIncrement(&_contention);
+
+    prev->next = &node;
+
+    while (node.locked)
+    {
+        SPINLOOP_PROCYIELD();
+    }
+}
+
+bool Synchronization::QueuedSpinlock::TryLock(QueuedSpinlockNode & node)
+{
+    node.next   = nullptr;
+    node.locked = 0;
+
+    return _InterlockedCompareExchangePointer(reinterpret_cast<void * volatile *>(&_tail), &node, nullptr) == nullptr;
+}
+
+void Synchronization::QueuedSpinlock::Unlock(QueuedSpinlockNode & node)
+{
+    if (!node.next)
+    {
+        if (_InterlockedCompareExchangePointer(reinterpret_cast<void * volatile *>(&_tail), nullptr, &node) == &node)
+            return;
+
+        // a successor swapped itself in but hasn't linked yet
+        while (!node.next)
+        {
+            SPINLOOP_PROCYIELD();
+        }
+    }
+
+    node.next->locked = 0;
+}
+
+bool Synchronization::QueuedSpinlock::IsLocked()
+{
+    return _tail ? true : false;
+}
+
+long Synchronization::QueuedSpinlock::GetContention()
+{
+    return _contention;
+}
@@ -0,0 +1,158 @@
+/*
+    Purpose: Address keyed wait/wake backed by a global sharded wait queue hash
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "OWaitOnAddress.hpp"
+
+#include <Core/Synchronization/OSpinlock.hpp>
+#include "LinuxSleeping.hpp"
+
+#define WAIT_ADDRESS_BUCKET_BITS 8
+#define WAIT_ADDRESS_BUCKETS     (1 << WAIT_ADDRESS_BUCKET_BITS)
+
+struct __declspec(align(SPINLOCK_CACHE_LINE)) WaitAddressBucket
+{
+    Synchronization::Spinlock lock;
+    volatile long waiters;      // lets wakers skip empty buckets without the lock
+    WaitListHead list;
+};
+
+struct AddressWaiter
+{
+    LinuxWaiter waiter;
+    volatile uint32_t * address;
+};
+
+// zero initialized: unlocked, no waiters, empty lists
+static WaitAddressBucket wait_address_table[WAIT_ADDRESS_BUCKETS];
+
+static WaitAddressBucket * WaitAddressGetBucket(volatile uint32_t * address)
+{
+    uint64_t hash;
+
+    hash = (uint64_t(address) >> 2) * 0x9E3779B97F4A7C15ull;
+    return &wait_address_table[hash >> (64 - WAIT_ADDRESS_BUCKET_BITS)];
+}
+
+error_t Synchronization::WaitOnAddress(volatile uint32_t * address, uint32_t expected, uint64_t deadline)
+{
+    WaitAddressBucket * bucket;
+    AddressWaiter entry;
+    bool signaled;
+
+    if (!address)
+        return kErrorIllegalBadArgument;
+
+    bucket = WaitAddressGetBucket(address);
+
+    bucket->lock.Lock();
+
+    // announce ourselves before comparing; wakers publish the value before checking waiters
+    _InterlockedIncrement(&bucket->waiters);
+
+    if (*address != expected)
+    {
+        _InterlockedDecrement(&bucket->waiters);
+        bucket->lock.Unlock();
+        return kStatusOkay;
+    }
+
+    LinuxWaiterInit(&entry.waiter);
+    entry.address = address;
+    LinuxWaiterEnqueue(&bucket->list, &entry.waiter);
+
+    bucket->lock.Unlock();
+
+    LinuxSleepDeadline(deadline, LinuxWaiterIsSignaled, &entry.waiter);
+
+    bucket->lock.Lock();
+    signaled = LinuxWaiterFinish(&bucket->list, &entry.waiter);
+    _InterlockedDecrement(&bucket->waiters);
+    bucket->lock.Unlock();
+
+    return signaled ? kStatusOkay : kStatusTimeout;
+}
+
+error_t Synchronization::WakeByAddress(volatile uint32_t * address, uint32_t count, uint32_t & woken)
+{
+    WaitAddressBucket * bucket;
+    LinuxWakeQueue wake;
+    WaitListNode * cur;
+    uint32_t claimed;
+
+    woken = 0;
+
+    if (!address)
+        return kErrorIllegalBadArgument;
+
+    bucket = WaitAddressGetBucket(address);
+
+    // the caller's store to *address may be a plain one: fence it ahead of our read of waiters.
+    // pairs with the waiter's locked increment of waiters before it compares *address
+    _mm_mfence();
+
+    if (!bucket->waiters)
+        return kStatusOkay;
+
+    LinuxWakeQueueInit(&wake);
+    claimed = 0;
+
+    bucket->lock.Lock();
+
+    cur = bucket->list.head;
+    while (cur && (claimed < count))
+    {
+        AddressWaiter * waiter;
+
+        waiter = WAIT_LIST_ENTRY(cur, AddressWaiter);
+        cur    = cur->next;
+
+        // other addresses may hash into the same bucket
+        if (waiter->address != address)
+            continue;
+
+        LinuxWakeQueueClaim(&wake, &bucket->list, &waiter->waiter);
+        claimed++;
+    }
+
+    bucket->lock.Unlock();
+
+    woken = uint32_t(LinuxWakeQueueWake(&wake));
+    return kStatusOkay;
+}
+
+Synchronization::Completion::Completion() : _state(0)
+{}
+
+void Synchronization::Completion::Set()
+{
+    uint32_t woken;
+
+    if (_InterlockedExchange(reinterpret_cast<volatile long *>(&_state), 1))
+        return;
+
+    WakeByAddress(&_state, -1, woken);
+}
+
+bool Synchronization::Completion::IsSet()
+{
+    return _state ? true : false;
+}
+
+error_t Synchronization::Completion::Wait(uint64_t deadline)
+{
+    while (!_state)
+    {
+        if (WaitOnAddress(&_state, 0, deadline) == kStatusTimeout)
+            return _state ? kStatusOkay : kStatusTimeout;
+    }
+
+    return kStatusOkay;
+}
+
+volatile uint32_t * Synchronization::Completion::GetAddress()
+{
+    return &_state;
+}
@@ -0,0 +1,10 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/Synchronization/OWaitOnAddress.hpp>
+
+LIBLINUX_SYM error_t Synchronization::WaitOnAddress(volatile uint32_t * address, uint32_t expected, uint64_t deadline);
+LIBLINUX_SYM error_t Synchronization::WakeByAddress(volatile uint32_t * address, uint32_t count, uint32_t & woken);
@@ -0,0 +1,135 @@
+/*
+    Purpose: Block on any/all of a set of waitable objects with a single sleeper
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#include <libos.hpp>
+#include "OWaitable.hpp"
+
+#include "LinuxSleeping.hpp"
+
+struct WaitMultipleSleep
+{
+    WaitMultipleBlock * block;
+    long generation;
+};
+
+void WaitableNotifyObservers(WaitListHead * observers)
+{
+    for (WaitListNode * cur = observers->head; cur != nullptr; cur = cur->next)
+    {
+        WaitMultipleBlock * block;
+
+        block = WAIT_LIST_ENTRY(cur, Synchronization::WaitableObserver)->block;
+
+        _InterlockedIncrement(&block->generation);
+        LinuxPokeThread(block->thread);
+    }
+}
+
+static bool WaitMultipleIsWaking(void * context)
+{
+    auto ctx = reinterpret_cast<WaitMultipleSleep *>(context);
+    return ctx->block->generation != ctx->generation;
+}
+
+static bool WaitMultipleTryAny(Synchronization::OWaitable ** objects, size_t count, size_t & index)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (objects[i]->WaitableTryAcquire())
+        {
+            index = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool WaitMultipleTryAll(Synchronization::OWaitable ** objects, size_t count)
+{
+    size_t acquired;
+
+    // don't take anything until everything looks ready, otherwise we'd spin on our own back-outs
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!objects[i]->WaitableIsSignaled())
+            return false;
+    }
+
+    for (acquired = 0; acquired < count; acquired++)
+    {
+        if (!objects[acquired]->WaitableTryAcquire())
+            break;
+    }
+
+    if (acquired == count)
+        return true;
+
+    while (acquired--)
+        objects[acquired]->WaitableRelease();
+
+    return false;
+}
+
+error_t Synchronization::WaitMultiple(Synchronization::OWaitable ** objects, size_t count, Synchronization::WaitMultipleMode_e mode, uint64_t deadline, size_t & index)
+{
+    WaitableObserver observers[WAIT_MULTIPLE_MAX];
+    WaitMultipleBlock block;
+    WaitMultipleSleep sleep;
+    bool acquired;
+    bool timedout;
+
+    if (!objects)
+        return kErrorIllegalBadArgument;
+
+    if ((count == 0) || (count > WAIT_MULTIPLE_MAX))
+        return kErrorIllegalSize;
+
+    if ((mode != kWaitAny) && (mode != kWaitAll))
+        return kErrorIllegalBadArgument;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!objects[i])
+            return kErrorIllegalBadArgument;
+    }
+
+    block.thread     = OSThread;
+    block.generation = 0;
+
+    // register before the first check so that a signal between the check and the sleep bumps the generation
+    for (size_t i = 0; i < count; i++)
+    {
+        observers[i].block = &block;
+        objects[i]->WaitableAddObserver(&observers[i]);
+    }
+
+    acquired = false;
+    timedout = false;
+    index    = 0;
+
+    while (true)
+    {
+        sleep.block      = &block;
+        sleep.generation = block.generation;
+
+        if (mode == kWaitAny)
+            acquired = WaitMultipleTryAny(objects, count, index);
+        else
+            acquired = WaitMultipleTryAll(objects, count);
+
+        if (acquired || timedout)
+            break;
+
+        // one last check after the deadline passes
+        if (!LinuxSleepDeadline(deadline, WaitMultipleIsWaking, &sleep))
+            timedout = true;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        objects[i]->WaitableRemoveObserver(&observers[i]);
+
+    return acquired ? kStatusOkay : kStatusTimeout;
+}
@@ -0,0 +1,27 @@
+/*
+    Purpose:
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/Synchronization/OWaitable.hpp>
+#include "WaitList.hpp"
+
+// one per WaitMultiple call, shared by every observer it registers
+struct WaitMultipleBlock
+{
+    task_k thread;
+    volatile long generation;
+};
+
+// one per waitable. lives on the WaitMultiple callers stack and must stay the first member for WAIT_LIST_ENTRY
+struct Synchronization::WaitableObserver
+{
+    WaitListNode node;
+    WaitMultipleBlock * block;
+};
+
+// call under the owning object's lock, after the state change that makes it signaled is visible
+extern void WaitableNotifyObservers(WaitListHead * observers);
+
+LIBLINUX_SYM error_t Synchronization::WaitMultiple(Synchronization::OWaitable ** objects, size_t count, Synchronization::WaitMultipleMode_e mode, uint64_t deadline, size_t & index);
@@ -10,24 +10,28 @@
 #include <ITypes/IThreadStruct.hpp>
 #include <ITypes/ITask.hpp>
 #include "LinuxSleeping.hpp"
+#include "OWaitable.hpp"
 
 struct WorkWaitingThreads
 {
-    Synchronization::SpuriousWakeup_f wakeup;
-    Synchronization::OWorkQueue * queue;
-    task_k thread;
-    bool signal;
+    LinuxWaiter waiter;
+    volatile bool poked;    // SpuriousWakeupOwners: go back and ask wakeup again
 };
 
-OWorkQueueImpl::OWorkQueueImpl(uint32_t workItems, mutex_k mutex, dyn_list_head_p listWorkers, dyn_list_head_p listWaiters)
+OWorkQueueImpl::OWorkQueueImpl(uint32_t workItems, Synchronization::WakePolicy_e policy, mutex_k mutex)
 {
     _activeWork  = 0;
     _completed   = 0;
     _owners      = 0;
     _workItems   = workItems;
     _acquisition = mutex;
-    _waiters     = listWorkers;
-    _workers     = listWaiters;
+    WaitListInit(&_waiters);
+    WaitListInit(&_workers);
+    WaitListInit(&_observers);
+    _policy      = policy;
+    _stats       = { 0 };
+    _pollBudget  = 0;
+    _pollStats   = { 0 };
 }
 
 error_t OWorkQueueImpl::GetCount(uint32_t & out)
@@ -38,6 +42,12 @@ error_t OWorkQueueImpl::GetCount(uint32_t & out)
 }
 
 error_t OWorkQueueImpl::WaitAndAddOwner(uint32_t ms, Synchronization::SpuriousWakeup_f wakeup)
+{
+    CHK_DEAD;
+    return WaitAndAddOwnerUntil(LinuxSleepDeadlineFromMS(ms), wakeup);
+}
+
+error_t OWorkQueueImpl::WaitAndAddOwnerUntil(uint64_t deadline, Synchronization::SpuriousWakeup_f wakeup)
 {
     CHK_DEAD;
     error_t err;
@@ -46,13 +56,14 @@ error_t OWorkQueueImpl::WaitAndAddOwner(uint32_t ms, Synchronization::SpuriousWa
 
     _owners++;
 
+    // the final EndWork bumps _completed before taking the lock to wake us, so this check cannot miss it
     if (_completed == _workItems)
     {
         err = kStatusWorkQueueAlreadyComplete;
         goto out;
     }
 
-    err = GoToSleep(ms, wakeup, true);
+    err = GoToSleep(deadline, wakeup, true);
 
     if (ERROR(err) || (err == kStatusTimeout))
     {
@@ -67,95 +78,97 @@ error_t OWorkQueueImpl::WaitAndAddOwner(uint32_t ms, Synchronization::SpuriousWa
 static bool WorkerThreadIsWaking(void * context)
 {
     auto ctx = reinterpret_cast <WorkWaitingThreads *>(context);
-    return ctx->signal || (ctx->wakeup && ctx->wakeup(ctx->queue));
-}
-
-error_t OWorkQueueImpl::NewThreadContext(WorkWaitingThreads * context, Synchronization::SpuriousWakeup_f wakeup, bool waiters)
-{
-    CHK_DEAD;
-    error_t err;
-    dyn_list_head_p list;
-    WorkWaitingThreads ** lentry;
-
-    list = waiters ? _waiters : _workers;
-
-    context->thread = OSThread;
-    context->signal = false;
-    context->wakeup = wakeup;
-    context->queue  = this;
-
-    err = dyn_list_append_ex(list, (void **)&lentry, nullptr);
-    if (ERROR(err))
-        return err;
-
-    *lentry = context;
-    return kStatusOkay;
+    return ctx->waiter.signal || ctx->poked;
 }
 
-error_t OWorkQueueImpl::GoToSleep(uint32_t ms, Synchronization::SpuriousWakeup_f wakeup, bool waiters)
+error_t OWorkQueueImpl::GoToSleep(uint64_t deadline, Synchronization::SpuriousWakeup_f wakeup, bool waiters)
 {
     CHK_DEAD;
     WorkWaitingThreads entry;
-    error_t err;
+    WaitListHead * list;
     bool signald;
 
+    list = waiters ? &_waiters : &_workers;
+
     // create new context
-    err = NewThreadContext(&entry, wakeup, waiters);
-    if (ERROR(err))
-        return err;
+    LinuxWaiterInit(&entry.waiter);
+    entry.poked = false;
+    LinuxWaiterEnqueue(list, &entry.waiter);
 
     // go to sleep 
     mutex_unlock(_acquisition);
-    signald = LinuxSleep(ms, WorkerThreadIsWaking, &entry);
+
+    // spin on our own signal only; the user's callback is far too expensive to poll and doesn't count as a completion
+    signald = LinuxPoll(_pollBudget, deadline, LinuxWaiterIsSignaled, &entry.waiter);
+
+    if (signald)
+        _InterlockedIncrement64(&_pollStats.pollHits);
+    else if (_pollBudget)
+        _InterlockedIncrement64(&_pollStats.sleeps);
+
+    while (!signald)
+    {
+        // the user's callback may block, so it's asked out here rather than from the sleep callback (which runs once we're TASK_INTERRUPTIBLE)
+        entry.poked = false;
+        if (wakeup && wakeup(this))
+        {
+            signald = true;
+            break;
+        }
+
+        signald = LinuxSleepDeadline(deadline, WorkerThreadIsWaking, &entry);
+
+        // a poke without a signal means go round and ask wakeup again
+        if (!signald || entry.waiter.signal)
+            break;
+
+        signald = false;
+    }
+
     mutex_lock(_acquisition);
+
+    // spurious wakeups leave us parked; unlink ourselves unless a waker beat us to it
+    if (LinuxWaiterFinish(list, &entry.waiter))
+        signald = true;
     
     return !signald ? kStatusTimeout : kStatusOkay;
 }
 
-error_t OWorkQueueImpl::ContExecution(bool waiters)
+void OWorkQueueImpl::ContExecution(bool waiters, LinuxWakeQueue * queue)
 {
-    CHK_DEAD;
-    error_t err;
-    size_t threads;
-    dyn_list_head_p list;
-    WorkWaitingThreads ** entry;
-
-    list = waiters ? _waiters : _workers;
+    // every owner needs to see the completion; workers beyond the free slots would only go back to sleep
+    if (waiters)
+        LinuxWakeQueueClaimMany(queue, &_waiters, -1, _policy, &_stats);
+    else
+        LinuxWakeQueueClaimMany(queue, &_workers, _workItems, _policy, &_stats);
+}
 
-    err = dyn_list_entries(list, &threads);
-    if (ERROR(err))
-        return err;
+bool OWorkQueueImpl::TryBeginWork()
+{
+    long active;
 
-    for (size_t i = 0; i < threads; i++)
+    // note: active workers never decrements - it only resets to zero once all owners have been released 
+    while ((active = _activeWork) < long(_workItems))
     {
-        task_k thread;
-
-        err = dyn_list_get_by_index(list, 0, reinterpret_cast<void **>(&entry));
-        ASSERT(NO_ERROR(err), "couldn't obtain waiting thread by index (error: " PRINTF_ERROR ")", err);
-
-        thread = (*entry)->thread;
-        (*entry)->signal = true;
-        LinuxPokeThread(thread);
-
-        // TODO: remove entry on spurious exit 
-        err = dyn_list_remove(list, 0);
-        ASSERT(NO_ERROR(err), "couldn't remove thread by index (error: " PRINTF_ERROR ")", err);
+        if (_InterlockedCompareExchange(&_activeWork, active + 1, active) == active)
+            return true;
     }
-    
-    return kStatusOkay;
+
+    return false;
 }
 
 error_t OWorkQueueImpl::BeginWork()
 {
     CHK_DEAD;
-    uint32_t next;
 
+    if (TryBeginWork())
+        return kStatusOkay;
+
+    // saturated: sleep until the owners have been released and the queue has been reset
     mutex_lock(_acquisition);
     {
-        if (_activeWork == _workItems) // note: active workers never decrements - it only resets to zero once all owners have been released 
-            GoToSleep(-1, NULL, false);
-     
-        _activeWork++; 
+        while (!TryBeginWork())
+            GoToSleep(LINUX_SLEEP_INFINITE, NULL, false);
     }
     mutex_unlock(_acquisition);
 
@@ -165,39 +178,37 @@ error_t OWorkQueueImpl::BeginWork()
 error_t OWorkQueueImpl::EndWork()
 {
     CHK_DEAD;
+    LinuxWakeQueue wake;
+
+    if (_InterlockedIncrement(&_completed) != long(_workItems))
+        return kStatusOkay;
+
+    // final unit of work - hand the queue over to every owner in a single pass
+    LinuxWakeQueueInit(&wake);
 
     mutex_lock(_acquisition);
     {
-        if ((++_completed) == _workItems)
-            ContExecution(true);
+        ContExecution(true, &wake);
+        WaitableNotifyObservers(&_observers);
     }
     mutex_unlock(_acquisition);
 
+    LinuxWakeQueueWake(&wake);
+
     return kStatusOkay;
 }
 
 error_t OWorkQueueImpl::SpuriousWakeupOwners()
 {
     CHK_DEAD;
-    error_t err;
-    size_t threads;
-    WorkWaitingThreads ** entry;
 
     mutex_lock(_acquisition);
 
-    err = dyn_list_entries(_waiters, &threads);
-    if (ERROR(err))
-        return err;
-
-    for (size_t i = 0; i < threads; i++)
+    // owners can't leave the queue without the lock, so poking them in place is safe
+    for (WaitListNode * cur = _waiters.head; cur != nullptr; cur = cur->next)
     {
-        task_k thread;
-
-        err = dyn_list_get_by_index(_waiters, 0, reinterpret_cast<void **>(&entry));
-        ASSERT(NO_ERROR(err), "couldn't obtain waiting thread by index (error: " PRINTF_ERROR ")", err);
-
-        thread = (*entry)->thread;
-        LinuxPokeThread(thread);
+        WAIT_LIST_ENTRY(cur, WorkWaitingThreads)->poked = true;
+        LinuxPokeThread(WAIT_LIST_ENTRY(cur, LinuxWaiter)->thread);
     }
 
     mutex_unlock(_acquisition);
@@ -208,6 +219,9 @@ error_t OWorkQueueImpl::ReleaseOwner()
 {
     CHK_DEAD;
     error_t err = kStatusOkay;
+    LinuxWakeQueue wake;
+
+    LinuxWakeQueueInit(&wake);
 
     mutex_lock(_acquisition);
     {
@@ -220,72 +234,104 @@ error_t OWorkQueueImpl::ReleaseOwner()
 
         if ((--_owners) == 0)
         {
-            _activeWork = 0;
-            _completed  = 0;
-            ContExecution(false);
+            // reset the completion count before any worker can begin the next cycle
+            _InterlockedExchange(&_completed, 0);
+            _InterlockedExchange(&_activeWork, 0);
+            ContExecution(false, &wake);
         }
 
     }
     out:
     mutex_unlock(_acquisition);
 
+    LinuxWakeQueueWake(&wake);
+
     return err;
 }
 
-void OWorkQueueImpl::InvalidateImp()
+error_t OWorkQueueImpl::GetWakeStats(Synchronization::WakeStats_t & stats)
 {
-    error_t err;
-    size_t count;
+    CHK_DEAD;
+
+    mutex_lock(_acquisition);
+    stats.wakes      = _stats.wakes;
+    stats.localWakes = _stats.localWakes;
+    mutex_unlock(_acquisition);
+
+    return kStatusOkay;
+}
+
+error_t OWorkQueueImpl::SetPollBudget(uint64_t ns)
+{
+    CHK_DEAD;
+    _pollBudget = MIN(ns, uint64_t(LINUX_POLL_BUDGET_MAX_NS));
+    return kStatusOkay;
+}
+
+error_t OWorkQueueImpl::GetPollStats(Synchronization::PollStats_t & stats)
+{
+    CHK_DEAD;
+    stats.pollHits = _pollStats.pollHits;
+    stats.sleeps   = _pollStats.sleeps;
+    return kStatusOkay;
+}
 
-    err = dyn_list_entries(_workers, &count);
-    ASSERT(NO_ERROR(err), "couldn't obtain length of waiters (error: " PRINTF_ERROR ")", err);
-    ASSERT(count == 0, "Destroyed work queue with work threads waiting");
+bool OWorkQueueImpl::WaitableIsSignaled()
+{
+    return _completed == long(_workItems);
+}
 
-    err = dyn_list_entries(_waiters, &count);
-    ASSERT(NO_ERROR(err), "couldn't obtain length of job dispatchers (error: " PRINTF_ERROR ")", err);
-    ASSERT(count == 0, "Destroyed work queue with job dispatcher threads waiting");
+bool OWorkQueueImpl::WaitableTryAcquire()
+{
+    return WaitableIsSignaled();
+}
+
+void OWorkQueueImpl::WaitableRelease()
+{
+}
+
+void OWorkQueueImpl::WaitableAddObserver(Synchronization::WaitableObserver * observer)
+{
+    mutex_lock(_acquisition);
+    WaitListAppend(&_observers, &observer->node);
+    mutex_unlock(_acquisition);
+}
+
+void OWorkQueueImpl::WaitableRemoveObserver(Synchronization::WaitableObserver * observer)
+{
+    mutex_lock(_acquisition);
+    WaitListRemove(&_observers, &observer->node);
+    mutex_unlock(_acquisition);
+}
+
+void OWorkQueueImpl::InvalidateImp()
+{
+    ASSERT(WaitListIsEmpty(&_observers), "Destroyed work queue with WaitMultiple observers");
+    ASSERT(WaitListIsEmpty(&_workers), "Destroyed work queue with work threads waiting");
+    ASSERT(WaitListIsEmpty(&_waiters), "Destroyed work queue with job dispatcher threads waiting");
 
-    dyn_list_destroy(_workers);
-    dyn_list_destroy(_waiters);
     mutex_destroy(_acquisition);
 }
 
 error_t Synchronization::CreateWorkQueue(size_t cont, const OOutlivableRef<Synchronization::OWorkQueue> out)
 {
-    dyn_list_head_p listPrimary;
-    dyn_list_head_p listSecondary;
+    return CreateWorkQueue(cont, kWakeFifo, out);
+}
+
+error_t Synchronization::CreateWorkQueue(size_t cont, Synchronization::WakePolicy_e policy, const OOutlivableRef<Synchronization::OWorkQueue> out)
+{
     mutex_k mutex;
-    OSimpleSemaphore * sema;
 
     if (cont > UINT32_MAX)
         return kErrorIllegalSize;
 
-    listPrimary = DYN_LIST_CREATE(WorkWaitingThreads*);
-
-    if (!listPrimary)
-        return kErrorOutOfMemory;
-
     mutex = mutex_init();
 
     if (!mutex)
-    {
-        dyn_list_destroy(listPrimary);
-        return kErrorOutOfMemory;
-    }
-
-    listSecondary = DYN_LIST_CREATE(WorkWaitingThreads*);
-
-    if (!listSecondary)
-    {
-        dyn_list_destroy(listPrimary);
-        mutex_destroy(mutex);
         return kErrorOutOfMemory;
-    }
 
-    if (!out.PassOwnership(new OWorkQueueImpl(cont, mutex, listSecondary, listPrimary)))
+    if (!out.PassOwnership(new OWorkQueueImpl(cont, policy, mutex)))
     {
-        dyn_list_destroy(listPrimary);
-        dyn_list_destroy(listSecondary);
         mutex_destroy(mutex);
         return kErrorOutOfMemory;
     }
@@ -4,28 +4,37 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #include <Core/Synchronization/OWorkQueue.hpp>
+#include "LinuxSleeping.hpp"
 
-class OSimpleSemaphore;
-struct WorkWaitingThreads;
 class OWorkQueueImpl : public Synchronization::OWorkQueue
 {
 public:
-    OWorkQueueImpl(uint32_t start_count, mutex_k mutex, dyn_list_head_p list_a, dyn_list_head_p list_b);
+    OWorkQueueImpl(uint32_t start_count, Synchronization::WakePolicy_e policy, mutex_k mutex);
 
     error_t GetCount(uint32_t &)                                     override;
     error_t EndWork()                                                override;
     error_t BeginWork()                                              override;
     error_t WaitAndAddOwner(uint32_t ms, Synchronization::SpuriousWakeup_f wakeup)    override;
+    error_t WaitAndAddOwnerUntil(uint64_t deadline, Synchronization::SpuriousWakeup_f wakeup) override;
     error_t ReleaseOwner()                                           override;
     error_t SpuriousWakeupOwners()                                   override;
+    error_t GetWakeStats(Synchronization::WakeStats_t & stats)       override;
+    error_t SetPollBudget(uint64_t ns)                               override;
+    error_t GetPollStats(Synchronization::PollStats_t & stats)       override;
+
+    bool WaitableIsSignaled()                                                    override; // all work items have completed
+    bool WaitableTryAcquire()                                                    override;
+    void WaitableRelease()                                                       override;
+    void WaitableAddObserver(Synchronization::WaitableObserver * observer)       override;
+    void WaitableRemoveObserver(Synchronization::WaitableObserver * observer)    override;
 
 protected:
     void InvalidateImp()                                             override;
 
 private:
-    error_t GoToSleep(uint32_t ms, Synchronization::SpuriousWakeup_f wakeup, bool workers);
-    error_t NewThreadContext(WorkWaitingThreads * context, Synchronization::SpuriousWakeup_f wakeup, bool waiters);
-    error_t ContExecution(bool workers);
+    bool    TryBeginWork();
+    error_t GoToSleep(uint64_t deadline, Synchronization::SpuriousWakeup_f wakeup, bool waiters);
+    void    ContExecution(bool waiters, LinuxWakeQueue * queue);
 
     mutex_k _acquisition;
     volatile long _owners;
@@ -33,8 +42,16 @@ private:
     volatile long _completed;
 
     uint32_t _workItems;
-    dyn_list_head_p _waiters;
-    dyn_list_head_p _workers;
+    WaitListHead _waiters;
+    WaitListHead _workers;
+    WaitListHead _observers;
+
+    Synchronization::WakePolicy_e _policy;
+    LinuxWakeStats _stats;
+
+    uint64_t _pollBudget;
+    LinuxPollStats _pollStats;
 };
 
 LIBLINUX_SYM error_t Synchronization::CreateWorkQueue(size_t cont, const OOutlivableRef<Synchronization::OWorkQueue> out);
+LIBLINUX_SYM error_t Synchronization::CreateWorkQueue(size_t cont, Synchronization::WakePolicy_e policy, const OOutlivableRef<Synchronization::OWorkQueue> out);
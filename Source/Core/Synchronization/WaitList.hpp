@@ -0,0 +1,90 @@
+/*
+    Purpose: Intrusive, allocation free FIFO used to park sleeping threads
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+
+// Embed a WaitListNode as the *first* member of your on-stack waiter context.
+// All operations are O(1) and must be serialized by the owning object's lock.
+struct WaitListNode
+{
+    WaitListNode * next;
+    WaitListNode * prev;
+};
+
+struct WaitListHead
+{
+    WaitListNode * head;
+    WaitListNode * tail;
+};
+
+#define WAIT_LIST_ENTRY(node, type) (reinterpret_cast<type *>(node))
+
+static inline void WaitListInit(WaitListHead * list)
+{
+    list->head = nullptr;
+    list->tail = nullptr;
+}
+
+static inline bool WaitListIsEmpty(WaitListHead * list)
+{
+    return list->head == nullptr;
+}
+
+static inline void WaitListAppend(WaitListHead * list, WaitListNode * node)
+{
+    node->next = nullptr;
+    node->prev = list->tail;
+
+    if (list->tail)
+        list->tail->next = node;
+    else
+        list->head = node;
+
+    list->tail = node;
+}
+
+// pos = nullptr inserts at the front
+static inline void WaitListInsertAfter(WaitListHead * list, WaitListNode * pos, WaitListNode * node)
+{
+    node->prev = pos;
+    node->next = pos ? pos->next : list->head;
+
+    if (node->next)
+        node->next->prev = node;
+    else
+        list->tail = node;
+
+    if (pos)
+        pos->next = node;
+    else
+        list->head = node;
+}
+
+static inline void WaitListRemove(WaitListHead * list, WaitListNode * node)
+{
+    if (node->prev)
+        node->prev->next = node->next;
+    else
+        list->head = node->next;
+
+    if (node->next)
+        node->next->prev = node->prev;
+    else
+        list->tail = node->prev;
+
+    node->next = nullptr;
+    node->prev = nullptr;
+}
+
+static inline WaitListNode * WaitListPopFront(WaitListHead * list)
+{
+    WaitListNode * node;
+
+    node = list->head;
+    if (node)
+        WaitListRemove(list, node);
+
+    return node;
+}
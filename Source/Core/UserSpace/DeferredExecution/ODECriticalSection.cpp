@@ -5,21 +5,25 @@
 */
 #include <libos.hpp>
 #include "ODECriticalSection.hpp"
+#include <Core/Synchronization/OMutex.hpp>
 
-static mutex_k mutex;
+static Synchronization::OMutex * mutex;
 
 void EnterDECriticalSection()
 {
-    mutex_lock(mutex);
+    mutex->Lock();
 }
 
 void LeaveDECriticalSection()
 {
-    mutex_unlock(mutex);
+    mutex->Unlock();
 }
 
 void InitDECriticalSection()
 {
-    mutex = mutex_create();
-    ASSERT(mutex, "couldn't allocate mutex");
+    error_t err;
+
+    err = Synchronization::CreateMutex(Synchronization::kMutexAdaptive, mutex);
+    ASSERT(NO_ERROR(err), "couldn't allocate mutex");
+    mutex->EnableProfiling("de_critical_section");
 }
@@ -11,8 +11,12 @@
 #include "../../Processes/OProcessHelpers.hpp"
 #include "../../Memory/Linux/OLinuxMemory.hpp"
 #include <Core/Utilities/OThreadUtilities.hpp>
+#include "../../../Utils/RCUHashMap.hpp"
 
-static chain_p tgid_map;
+#define TGID_MAP_BUCKETS 256
+
+static RCUHashMap<ODEImplProcess *> tgid_map;  // lock-free lookups
+static mutex_k tgid_mutex;                      // serializes creation, so MapReturnStub runs once per process
 
 static error_t AllocateDEThread(task_k task, chain_p chain, size_t pid, ODEImplProcess * process, ODEImplPIDThread * & thread);
 
@@ -32,6 +36,32 @@ ODEImplProcess::~ODEImplProcess()
     ASSERT(NO_ERROR(err), "Couldn't free process pid tree");
 }
 
+bool ODEImplProcess::TryAddRef()
+{
+    long refs;
+
+    do
+    {
+        refs = _refs;
+
+        if (!refs)
+            return false;
+
+    } while (_InterlockedCompareExchange(&_refs, refs + 1, refs) != refs);
+
+    return true;
+}
+
+void ODEImplProcess::Release()
+{
+    if (_InterlockedDecrement(&_refs))
+        return;
+
+    // tear down now, but lock-free lookups may still be peeking at _refs; the memory goes back after a grace period
+    this->~ODEImplProcess();
+    RCU::DeferredFree(this);
+}
+
 size_t ODEImplProcess::GetReturnAddress()
 {
     return _returnAddress;
@@ -140,38 +170,53 @@ static error_t AllocateDEThread(task_k task, chain_p chain, size_t pid, ODEImplP
     return kStatusOkay;
 }
 
-static void DeallocateProcessByHandle(uint64_t hash, void * buffer)
+static bool LookupDEProcess(size_t tgid, ODEImplProcess * & out)
 {
-    delete *reinterpret_cast<ODEImplProcess **>(buffer);
+    bool found;
+
+    // the reference has to be taken inside the read section; a concurrent FreeDEProcess may be dropping the last one
+    RCU::ReadLock();
+    found = tgid_map.Lookup(tgid, out) && out->TryAddRef();
+    RCU::ReadUnlock();
+
+    return found;
 }
 
 static error_t AllocateDEProcess(task_k task, size_t tgid, ODEImplProcess * & out)
 {
     error_t err;
-    link_p link;
-    ODEImplProcess ** handle;
     ODEImplProcess * proc;
+    void * memory;
     chain_p chain;
 
+    // lost the race to another thread of the same group
+    if (LookupDEProcess(tgid, out))
+        return kStatusOkay;
+
     err = chain_allocate(&chain);
     if (ERROR(err))
         return err;
 
-    err = chain_allocate_link(tgid_map, tgid, sizeof(ODEImplProcess *), DeallocateProcessByHandle, &link, reinterpret_cast<void **>(&handle));
-    if (ERROR(err))
+    // zalloc + placement new so Release can hand the memory to RCU::DeferredFree
+    memory = zalloc(sizeof(ODEImplProcess));
+    if (!memory)
     {
         chain_destroy(chain);
-        return err;
+        return kErrorOutOfMemory;
     }
 
-    proc = new ODEImplProcess(task, chain);
-    if (!proc)
+    // born with both the map's reference and ours: a FreeDEProcess straight after the insert mustn't see the last one
+    proc = new (memory) ODEImplProcess(task, chain);
+
+    err = tgid_map.Insert(tgid, proc);
+    if (ERROR(err))
     {
-        chain_destroy(chain);
-        return kErrorOutOfMemory;
+        // never published, nobody else can hold a reference
+        proc->~ODEImplProcess();
+        free(memory);
+        return err;
     }
 
-    *handle = proc;
     out = proc;
     return kStatusOkay;
 }
@@ -180,7 +225,6 @@ error_t GetDEProcess(ODEImplProcess * & out, task_k task)
 {
     error_t err;
     size_t pid, tgid;
-    ODEImplProcess ** handle;
 
     tgid = ProcessesGetTgid(task);
     pid  = ProcessesGetPid(task);
@@ -188,24 +232,20 @@ error_t GetDEProcess(ODEImplProcess * & out, task_k task)
     if (pid != tgid)
         LogPrint(kLogWarning, "GetDEProcess called with a thread, not a group leader instance");
 
-    err = chain_get(tgid_map, tgid, NULL, reinterpret_cast<void **>(&handle));
-
-    if (err == kErrorLinkNotFound)
-        return AllocateDEProcess(task, tgid, out);
-
-    if (ERROR(err))
-        return err;
+    if (LookupDEProcess(tgid, out))
+        return kStatusOkay;
 
-    out = *handle;
-    return kStatusOkay;
+    mutex_lock(tgid_mutex);
+    err = AllocateDEProcess(task, tgid, out);
+    mutex_unlock(tgid_mutex);
+    return err;
 }
 
 void FreeDEProcess(task_k task)
 {
     error_t err;
-    link_p link;
     size_t pid, tgid;
-    ODEImplProcess ** handle;
+    ODEImplProcess * proc;
 
     tgid = ProcessesGetTgid(task);
     pid  = ProcessesGetPid(task);
@@ -213,22 +253,22 @@ void FreeDEProcess(task_k task)
     if (pid != tgid)
         LogPrint(kLogWarning, "GetDEProcess called with a thread, not a group leader instance");
 
-    err = chain_get(tgid_map, tgid, &link, reinterpret_cast<void **>(&handle));
-    if (err == XENUS_ERROR_LINK_NOT_FOUND)
+    err = tgid_map.Remove(tgid, &proc);
+    if (err == kErrorLinkNotFound)
         return;
     ASSERT(NO_ERROR(err), "Couldn't free DE process object.        Error: " PRINTF_ERROR, err);
 
-    err = chain_deallocate_handle(link);
-    ASSERT(NO_ERROR(err), "Couldn't free DE process object handle. Error: " PRINTF_ERROR, err);
-
-    //delete (*handle);
-    //deallocated by chain callback
+    // the map's reference; GetDEProcess callers still using it keep it alive
+    proc->Release();
 }
 
 void InitDEProcesses()
 {
     error_t err;
 
-    err = chain_allocate(&tgid_map);
+    err = tgid_map.Init(TGID_MAP_BUCKETS);
     ASSERT(NO_ERROR(err), "couldn't allocate tgid map: " PRINTF_ERROR, err);
+
+    tgid_mutex = mutex_allocate();
+    ASSERT(tgid_mutex, "couldn't allocate tgid map mutex");
 }
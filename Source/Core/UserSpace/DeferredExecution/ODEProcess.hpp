@@ -12,6 +12,10 @@ public:
     ODEImplProcess(task_k task, chain_p pids);
     ~ODEImplProcess();
 
+    // one reference belongs to tgid_map, the rest to GetDEProcess callers
+    bool                  TryAddRef();     // fails once the last reference is gone
+    void                  Release();
+
     size_t                GetReturnAddress();
     ODEImplPIDThread *    GetOrCreateThread(task_k task);
     error_t               GetThread(task_k task, ODEImplPIDThread * & thread);
@@ -23,9 +27,10 @@ private:
     chain_p _pids         = nullptr;
     task_k _task          = nullptr;
     size_t _returnAddress = 0;
+    volatile long _refs   = 2; // the tgid map's, plus whoever created us
 };
 
-extern error_t GetDEProcess(ODEImplProcess * & out, task_k task);
+extern error_t GetDEProcess(ODEImplProcess * & out, task_k task); // out is referenced; Release() it when done
 extern void FreeDEProcess(task_k task);
 
 extern void InitDEProcesses();
@@ -368,6 +368,8 @@ error_t GetDEThread(ODEImplPIDThread * & thread, task_k task)
         return err;
 
     err = proc->GetThread(task, thread);
+    proc->Release();
+
     if (ERROR(err))
         return err;
 
@@ -384,6 +386,8 @@ error_t GetOrCreateDEThread(ODEImplPIDThread * & thread, task_k task)
         return err;
 
     thread = proc->GetOrCreateThread(task);
+    proc->Release();
+
     if (!thread)
         return kErrorOutOfMemory;
 
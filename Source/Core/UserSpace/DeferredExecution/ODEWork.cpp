@@ -8,8 +8,9 @@
 #include "ODEThread.hpp"
 #include "../../Processes/OProcessHelpers.hpp"
 #include "ODeferredExecution.hpp"
+#include <Core/Synchronization/OMutex.hpp>
 
-static mutex_k work_watcher_mutex;
+static Synchronization::OMutex * work_watcher_mutex;
 
 ODEWorkHandler::ODEWorkHandler(task_k tsk, ODEWorkJobImpl * worker)
 {
@@ -34,14 +35,14 @@ void ODEWorkHandler::Hit(size_t response)
     ODECompleteCallback_f callback = nullptr;
     void * context = nullptr;
 
-    mutex_lock(work_watcher_mutex);
+    work_watcher_mutex->Lock();
     if (_parant)
     {
         _parant->Trigger(response);
         _parant->GetCallback(callback, context);
         _parant->DeattachWorkObject();
     }
-    mutex_unlock(work_watcher_mutex);
+    work_watcher_mutex->Unlock();
 
     if (callback)
         callback(context);
@@ -51,12 +52,12 @@ void ODEWorkHandler::Hit(size_t response)
 
 void ODEWorkHandler::Die()
 {
-    mutex_lock(work_watcher_mutex);
+    work_watcher_mutex->Lock();
     if (_parant)
     {
         _parant->DeattachWorkObject();
     }
-    mutex_unlock(work_watcher_mutex);
+    work_watcher_mutex->Unlock();
     delete this;
 }
 
@@ -91,15 +92,19 @@ error_t ODEWorkHandler::Schedule()
 
 void DestoryWorkHandler(ODEWorkJobImpl * job)
 {
-    mutex_lock(work_watcher_mutex);
+    work_watcher_mutex->Lock();
     auto worker = job->GetWorkObject();
     if (worker)
         worker->DeattachWorkObject();
-    mutex_unlock(work_watcher_mutex);
+    work_watcher_mutex->Unlock();
 }
 
 void InitDEWorkHandlers()
 {
-    work_watcher_mutex = mutex_create();
-    ASSERT(work_watcher_mutex, "couldn't allocate mutex");
+    error_t err;
+
+    err = Synchronization::CreateMutex(Synchronization::kMutexSleeping, work_watcher_mutex);
+    ASSERT(NO_ERROR(err), "couldn't allocate mutex");
+
+    work_watcher_mutex->EnableProfiling("work_watcher");
 }
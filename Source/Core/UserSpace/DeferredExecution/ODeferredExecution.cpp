@@ -4,7 +4,6 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #include <libos.hpp>
-#include <Core/Synchronization/OWorkQueue.hpp>
 #include <Core/Processes/OProcesses.hpp>
 #include "ODeferredExecution.hpp"
 #include "ODECriticalSection.hpp"
@@ -15,19 +14,20 @@
 #include "CallingConventions/CCManager.hpp"
 
 #include "../../Processes/OProcessHelpers.hpp"
+#include "../../Synchronization/LinuxSleeping.hpp"
+#include "../../Synchronization/OWaitable.hpp"
 
 static error_t APC_AddPendingWork(task_k tsk, ODEWorkHandler * impl);
 
-ODEWorkJobImpl::ODEWorkJobImpl(task_k task, OPtr<Synchronization::OWorkQueue> workqueue)
+ODEWorkJobImpl::ODEWorkJobImpl(task_k task)
 {
     _worker           = nullptr;
-    _state.execd      = false;
     _state.dispatched = false;
     _work             = { 0 };
     _task             = task;
     _callback.func    = nullptr;
     _callback.data    = nullptr;
-    _workqueue        = workqueue;
+    WaitListInit(&_observers);
 
     ProcessesTaskIncrementCounter(task);
 }
@@ -68,7 +68,7 @@ error_t ODEWorkJobImpl::HasDispatched(bool & dispatched)
 error_t ODEWorkJobImpl::HasExecuted(bool & executed)
 {
     CHK_DEAD;
-    executed = _state.execd;
+    executed = _executed.IsSet();
     return kStatusOkay;
 }
 
@@ -76,7 +76,30 @@ error_t ODEWorkJobImpl::WaitExecute(uint32_t ms)
 {
     CHK_DEAD;
 
-    return _workqueue->DumbWait(ms);
+    return WaitExecuteUntil(LinuxSleepDeadlineFromMS(ms));
+}
+
+static bool WorkJobHasExecuted(void * context)
+{
+    return reinterpret_cast<Synchronization::Completion *>(context)->IsSet();
+}
+
+error_t ODEWorkJobImpl::WaitExecuteUntil(uint64_t deadline)
+{
+    CHK_DEAD;
+
+    if (_pollBudget && !_executed.IsSet())
+    {
+        if (LinuxPoll(_pollBudget, deadline, WorkJobHasExecuted, &_executed))
+        {
+            _InterlockedIncrement64(&_pollStats.pollHits);
+            return kStatusOkay;
+        }
+
+        _InterlockedIncrement64(&_pollStats.sleeps);
+    }
+
+    return _executed.Wait(deadline);
 }
 
 error_t ODEWorkJobImpl::AwaitExecute(ODECompleteCallback_f cb, void * context)
@@ -95,7 +118,50 @@ error_t ODEWorkJobImpl::GetResponse(size_t & ret)
     ret = _state.response;
     return kStatusOkay;
 }
+
+error_t ODEWorkJobImpl::SetPollBudget(uint64_t ns)
+{
+    CHK_DEAD;
+    _pollBudget = MIN(ns, uint64_t(LINUX_POLL_BUDGET_MAX_NS));
+    return kStatusOkay;
+}
+
+error_t ODEWorkJobImpl::GetPollStats(Synchronization::PollStats_t & stats)
+{
+    CHK_DEAD;
+    stats.pollHits = _pollStats.pollHits;
+    stats.sleeps   = _pollStats.sleeps;
+    return kStatusOkay;
+}
 
+bool ODEWorkJobImpl::WaitableIsSignaled()
+{
+    return _executed.IsSet();
+}
+
+bool ODEWorkJobImpl::WaitableTryAcquire()
+{
+    return WaitableIsSignaled();
+}
+
+void ODEWorkJobImpl::WaitableRelease()
+{
+}
+
+void ODEWorkJobImpl::WaitableAddObserver(Synchronization::WaitableObserver * observer)
+{
+    _observerLock.Lock();
+    WaitListAppend(&_observers, &observer->node);
+    _observerLock.Unlock();
+}
+
+void ODEWorkJobImpl::WaitableRemoveObserver(Synchronization::WaitableObserver * observer)
+{
+    _observerLock.Lock();
+    WaitListRemove(&_observers, &observer->node);
+    _observerLock.Unlock();
+}
+
 ODEWorkHandler * ODEWorkJobImpl::GetWorkObject()
 {
     return _worker;
@@ -105,8 +171,6 @@ void ODEWorkJobImpl::InvalidateImp()
 {
     DestoryWorkHandler(this);
 
-    _workqueue->Destroy();
-
     if (_task)
         ProcessesTaskDecrementCounter(_task);
 }
@@ -119,9 +183,11 @@ void ODEWorkJobImpl::DeattachWorkObject()
 void ODEWorkJobImpl::Trigger(size_t response)
 {
     _state.response = response;
-    _state.execd    = true;
+    _executed.Set();
 
-    _workqueue->Trigger();
+    _observerLock.Lock();
+    WaitableNotifyObservers(&_observers);
+    _observerLock.Unlock();
 }
 
 void ODEWorkJobImpl::GetCallback(ODECompleteCallback_f & callback, void * & context)
@@ -134,20 +200,15 @@ LIBLINUX_SYM error_t CreateWorkItem(OPtr<OProcessThread> target, const OOutlivab
 {
     error_t err;
     task_k handle;
-    OPtr<Synchronization::OWorkQueue> wq;
 
     if (!target.GetTypedObject())
         return kErrorIllegalBadArgument;
     
-    err = Synchronization::CreateWorkQueue(1, wq);
-    if (ERROR(err))
-        return err;
-
     err = target->GetOSHandle((void **)&handle);
     if (ERROR(err))
         return err;
 
-    if (!out.PassOwnership(new ODEWorkJobImpl(handle, wq)))
+    if (!out.PassOwnership(new ODEWorkJobImpl(handle)))
         return kErrorOutOfMemory;
 
     return kStatusOkay;
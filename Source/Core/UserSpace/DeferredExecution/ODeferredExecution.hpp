@@ -4,8 +4,11 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #pragma once
-#include <Core/Synchronization/OWorkQueue.hpp> 
+#include <Core/Synchronization/OWaitOnAddress.hpp>
+#include <Core/Synchronization/OSpinlock.hpp>
 #include <Core/UserSpace/ODeferredExecution.hpp>
+#include "../../Synchronization/WaitList.hpp"
+#include "../../Synchronization/LinuxSleeping.hpp"
 
 #define APC_STACK_PAGES CONFIG_APC_STACK_PAGES
 
@@ -15,7 +18,7 @@ class ODEWorkHandler;
 class ODEWorkJobImpl : public ODEWorkJob
 {
 public:
-    ODEWorkJobImpl(task_k task, OPtr<Synchronization::OWorkQueue> workqueue);
+    ODEWorkJobImpl(task_k task);
                                                                    
     error_t SetWork(ODEWork &)                                     override;
                                                                    
@@ -25,10 +28,20 @@ public:
     error_t HasExecuted(bool &)                                    override;
                                                                    
     error_t WaitExecute(uint32_t ms)                               override;
+    error_t WaitExecuteUntil(uint64_t deadline)                    override;
     error_t AwaitExecute(ODECompleteCallback_f cb, void * context) override;
                                                                    
     error_t GetResponse(size_t & ret)                              override;
 
+    error_t SetPollBudget(uint64_t ns)                             override;
+    error_t GetPollStats(Synchronization::PollStats_t & stats)     override;
+
+    bool WaitableIsSignaled()                                      override; // job has executed
+    bool WaitableTryAcquire()                                      override;
+    void WaitableRelease()                                         override;
+    void WaitableAddObserver(Synchronization::WaitableObserver *)  override;
+    void WaitableRemoveObserver(Synchronization::WaitableObserver *) override;
+
     void GetCallback(ODECompleteCallback_f & callback, void * & context);
     void Trigger(size_t response);
     void DeattachWorkObject();                                                
@@ -39,13 +52,16 @@ protected:
     void InvalidateImp()                                           override;
                                                                    
 private:
-    OPtr<Synchronization::OWorkQueue> _workqueue;
+    Synchronization::Completion _executed;
+    Synchronization::Spinlock _observerLock;
+    WaitListHead _observers;
+    uint64_t         _pollBudget  = 0;
+    LinuxPollStats   _pollStats   = {0};
     task_k           _task        = {0};
     ODEWorkHandler * _worker      = nullptr;
     ODEWork          _work        = {0};
     struct
     {
-        bool   execd;
         bool   dispatched;
         size_t response;
     } _state                      = {0};
@@ -6,9 +6,9 @@
 #include <libos.hpp>
 #include "ODelegtedCalls.hpp"
 #include "../DeferredExecution/ODEThread.hpp"
+#include "../../../Utils/RCUHashMap.hpp"
 
-static mutex_k symbol_mutex;
-static dyn_list_head_p delegated_fns;
+#define DELEGATED_CALLS_BUCKETS 64
 
 typedef struct SysJob_s
 {
@@ -22,6 +22,10 @@ typedef struct DelegatedCallInstance_s
     char name[100];
 } DelegatedCallInstance_t, *DelegatedCallInstance_p;
 
+// attention id -> instance. instances are never removed, so lookups hand out raw pointers
+static RCUHashMap<DelegatedCallInstance_p> delegated_fns;
+static volatile long delegated_count;
+
 error_t AddKernelSymbol(const char * name, DelegatedCall_t fn)
 {
     error_t er;
@@ -33,20 +37,20 @@ error_t AddKernelSymbol(const char * name, DelegatedCall_t fn)
     if (!fn)
         return kErrorIllegalBadArgument;
 
-    mutex_lock(symbol_mutex);
+    inst = (DelegatedCallInstance_p)zalloc(sizeof(DelegatedCallInstance_t));
+    if (!inst)
+        return kErrorOutOfMemory;
+
+    memcpy(inst->name, name, MIN(strlen(name), sizeof(inst->name) - 1));
+    inst->fn = fn;
 
-    er = dyn_list_append(delegated_fns, (void **)&inst);
+    er = delegated_fns.Insert(uint64_t(_InterlockedIncrement(&delegated_count) - 1), inst);
     if (ERROR(er))
     {
-        mutex_unlock(symbol_mutex);
+        free(inst);
         return er;
     }
-   
-    memset(inst, 0, sizeof(DelegatedCallInstance_p));
-    memcpy(inst->name, name, MIN(strlen(name), sizeof(inst->name) - 1));
-    inst->fn = fn;
 
-    mutex_unlock(symbol_mutex);
     return kStatusOkay;
 }
 
@@ -54,18 +58,9 @@ static size_t DelegatedCallsGetBuffer(void * buf, size_t len)
 {
     size_t cnt;
     size_t index;
-    error_t err;
 
     index = 0;
-
-    mutex_lock(symbol_mutex);
-
-    err = dyn_list_entries(delegated_fns, &cnt);
-    if (ERROR(err))
-    {
-        LogPrint(kLogError, "dyn_list_entries failed: " PRINTF_ERROR ". how even? wtf", err);
-        goto exit;
-    }
+    cnt   = size_t(delegated_count);
 
     ASSERT(cnt < UINT32_MAX, "too many allocated syscalls");
 
@@ -73,19 +68,16 @@ static size_t DelegatedCallsGetBuffer(void * buf, size_t len)
     {
         size_t nlen;
         DelegatedCallInstance_p fn;
-        
-        err = dyn_list_get_by_index(delegated_fns, i, (void **)&fn);
-        if (ERROR(err))
-        {
-            LogPrint(kLogError, "dyn_list_get_by_index failed: " PRINTF_ERROR ". how even? wtf", err);
-            goto exit;
-        }
+
+        // id reserved by a concurrent AddKernelSymbol, but not yet published
+        if (!delegated_fns.Lookup(i, fn))
+            continue;
         
         nlen = strlen(fn->name) + 1;
 
         if (buf)
             if (nlen + sizeof(uint32_t) + index > len)
-                goto exit;
+                break;
 
         if (buf)
             memcpy((void *)(size_t(buf) + index), fn->name, nlen);
@@ -96,8 +88,6 @@ static size_t DelegatedCallsGetBuffer(void * buf, size_t len)
         index += sizeof(uint32_t);
     }
 
-exit:
-    mutex_unlock(symbol_mutex);
     return index;
 }
 
@@ -141,22 +131,7 @@ static size_t DelegatedCallsHandlePull(xenus_syscall_p atten)
 
 static bool DelegatedCallsLookup(size_t id, DelegatedCallInstance_p & out)
 {
-    error_t err;
-    DelegatedCallInstance_p fn;
-
-    mutex_lock(symbol_mutex);
-
-    err = dyn_list_get_by_index(delegated_fns, id, (void **)&fn);
-    if (ERROR(err))
-    {
-        mutex_unlock(symbol_mutex);
-        return false;
-    }
-
-    mutex_unlock(symbol_mutex);
-
-    out = fn;
-    return true;
+    return delegated_fns.Lookup(id, out);
 }
 
 static void DelegatedCallsInitJobContext(xenus_syscall_p atten, bool buffered, SysJob_s & job)
@@ -223,9 +198,8 @@ void DelegatedCallsSysCallHandler(xenus_syscall_ref atten)
 
 void InitDelegatedCalls()
 {
-    delegated_fns = DYN_LIST_CREATE(DelegatedCallInstance_t);
-    ASSERT(delegated_fns, "couldn't create dynamic list for delegated calls");
+    error_t err;
 
-    symbol_mutex = mutex_create();
-    ASSERT(symbol_mutex, "couldn't create delegated call mutex");
+    err = delegated_fns.Init(DELEGATED_CALLS_BUCKETS);
+    ASSERT(NO_ERROR(err), "couldn't create delegated call table: " PRINTF_ERROR, err);
 }
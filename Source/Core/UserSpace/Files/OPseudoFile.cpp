@@ -7,9 +7,12 @@
 
 #include <ITypes/IFileOperations.hpp>
 #include "OPseudoFile.hpp"
+#include "../../../Utils/RCUHashMap.hpp"
 
-static mutex_k pfns_mutex;
-static chain_p pseudo_file_handles;
+#define PSEUDO_FILE_BUCKETS 64
+
+static mutex_k pfns_mutex; // serializes id allocation; lookups are lock-free
+static RCUHashMap<OPseudoFileImpl *> pseudo_file_handles;
 static class_k psudo_file_class;
 
 static void FreeFileHandle(OPseudoFileImpl * out);
@@ -276,18 +279,11 @@ static error_t GetNextFileId(size_t & id)
 {
     for (size_t i = 0; i < SIZE_T_MAX; i++)
     {
-        error_t search;
-        
-        search = chain_get(pseudo_file_handles, i, NULL, NULL);
-        
-        if (search == kErrorLinkNotFound)
+        if (!pseudo_file_handles.Contains(i))
         {
             id = i;
             return kStatusOkay;
         }
-
-        if (ERROR(search))
-            return search;
     }
 
     return kErrorOutOfUIDs;
@@ -298,7 +294,6 @@ static error_t AllocateNewFileHandle(OPseudoFileImpl ** out)
     error_t er;
     size_t id;
     OPseudoFileImpl * file;
-    OPseudoFileImpl ** handle_ref;
     PsudoFileInformation_t info;
 
     er = GetNextFileId(id);
@@ -308,19 +303,17 @@ static error_t AllocateNewFileHandle(OPseudoFileImpl ** out)
     info.pub.devfs.char_dev_id = id;
     info.pub.type = PsuedoFileType_e::ksLinuxCharDev;
 
-    er = chain_allocate_link(pseudo_file_handles, id, sizeof(OPseudoFileImpl *), NULL, &info.priv.file_handle, (void **)&handle_ref);
-    if (ERROR(er))
-        return er;
-
     file = new OPseudoFileImpl(info);
     if (!file)
-    {
-        chain_deallocate_handle(info.priv.file_handle);
-        mutex_unlock(pfns_mutex);
         return kErrorOutOfMemory;
+
+    er = pseudo_file_handles.Insert(id, file);
+    if (ERROR(er))
+    {
+        delete file;
+        return er;
     }
 
-    *handle_ref = file;
     *out = file;
     return kStatusOkay;
 }
@@ -337,7 +330,7 @@ static error_t AllocateNewFileHandle_s(OPseudoFileImpl ** out)
 static void FreeFileHandle(OPseudoFileImpl * out)
 {
     mutex_lock(pfns_mutex);
-    chain_deallocate_handle(out->GetInfo()->priv.file_handle);
+    pseudo_file_handles.Remove(out->GetInfo()->pub.devfs.char_dev_id);
     mutex_unlock(pfns_mutex);
 }
 
@@ -349,8 +342,8 @@ void InitPseudoFiles()
     psudo_file_class = __class_create(0/* Lets just impersonate the linux kernel*/, "xenus", (lock_class_key_k)&temp);
     ASSERT(!LINUX_PTR_ERROR(psudo_file_class), "couldn't register pseudofile class");
 
-    er = chain_allocate(&pseudo_file_handles);
-    ASSERT(NO_ERROR(er), "couldn't allocate file handle chain: error code " PRINTF_ERROR, er);
+    er = pseudo_file_handles.Init(PSEUDO_FILE_BUCKETS);
+    ASSERT(NO_ERROR(er), "couldn't allocate file handle table: error code " PRINTF_ERROR, er);
 
     pfns_mutex = mutex_allocate();
     ASSERT(pfns_mutex, "couldn't allocate file tracker mutex");
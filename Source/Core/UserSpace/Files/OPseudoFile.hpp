@@ -33,10 +33,6 @@ typedef struct PsudoFileInformation_s
             } devfs;
         };
     } pub;
-    struct
-    {
-        link_p file_handle;
-    } priv;
 } PsudoFileInformation_t, *PsudoFileInformation_ref, *PsudoFileInformation_p;
 
 
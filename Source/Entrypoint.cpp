@@ -16,6 +16,11 @@
 #include "Core/UserSpace/ORegistration.hpp"
 #include "Core/UserSpace/ODeferredExecution.hpp"
 #include "Core/CPU/OThread.hpp"
+#include "Core/CPU/OThreadPool.hpp"
+#include "Core/CPU/OThreadExit.hpp"
+#include "Core/CPU/OTimer.hpp"
+#include "Core/Synchronization/LockProfiler.hpp"
+#include "Utils/RCU.hpp"
 
 XENUS_BEGIN_C
     #include <kernel/peloader/pe_loader.h>
@@ -34,13 +39,18 @@ static c_bool libos_init(mod_dependency_list_p deps)
     RuntimeCallConstructors();
 
     LoggingInit();
+    RCU::InitRCU();
     InitPseudoFiles();
+    InitLockProfiler();
     InitDelegatedCalls();
+    InitThreadExit();
     InitProcesses();
     InitProcessTracking();
     InitRegistration();
     InitMemmory();
     InitThreading();
+    InitThreadPool();
+    InitTimers();
     InitDeferredCalls();
     return true;
 }
@@ -7,8 +7,9 @@
 #include <Core\FIO\OFile.hpp>
 #include <Core\FIO\ODirectory.hpp>
 #include <Utils\DateHelper.hpp>
+#include <Core\Synchronization\OMutex.hpp>
 
-static mutex_k logging_mutex;
+static Synchronization::OMutex * logging_mutex;
 static char logging_tline[PRINTF_MAX_STRING_LENGTH];
 static char logging_tstr[PRINTF_MAX_STRING_LENGTH];
 static IO::OFile * log_file;
@@ -36,14 +37,14 @@ static void LoggingGetTs(char * ts)
 
 static void LoggingAppendLine(const char * ln)
 {
-    mutex_lock(logging_mutex);
+    logging_mutex->Lock();
     if (log_file)
     {
         log_file->Write(ln);
         log_file->Write("\n");
     }
     printf("\r-------------------\r%s\n", ln);
-    mutex_unlock(logging_mutex);
+    logging_mutex->Unlock();
 }
 
 static const char * LoggingLevelStringify(LoggingLevel_e lvl)
@@ -70,10 +71,13 @@ void LoggingPrint(const char * mod, LoggingLevel_e lvl, const char * msg, va_lis
 
 static void LoggingInitAllocations()
 {
+    error_t err;
+
     log_file = nullptr;
 
-    logging_mutex = mutex_create();
-    ASSERT(logging_mutex, "failed to create logging mutex");
+    err = Synchronization::CreateMutex(Synchronization::kMutexAdaptive, logging_mutex);
+    ASSERT(NO_ERROR(err), "failed to create logging mutex");
+    logging_mutex->EnableProfiling("logging");
 }
 
 static bool LoggingInitTryCreateDir(const OOutlivableRef<IO::ODirectory> & dir)
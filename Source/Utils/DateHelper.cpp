@@ -6,6 +6,7 @@
 */  
 #include <libos.hpp>
 #include "DateHelper.hpp"
+#include <Core/Synchronization/OSeqLock.hpp>
 
 static const char * month_names[] = {
     "January", "Febuary", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December"
@@ -15,25 +16,61 @@ static const char * day_names[] = {
     "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday"
 };
 
+// sys_tz can be changed from userland (settimeofday); refresh our copy every so often rather than caching it forever
+#define TZ_REFRESH_NS S_TO_NS(1ull)
+
 static timezone * sys_tz = nullptr;
-static int64_t tz_offset = -1;
+static Synchronization::OSeqLock tz_lock;
+static struct
+{
+    int64_t  offset;
+    uint64_t refreshed;   // boot time ns, 0 = never
+} tz_cache;
 
 static bool TimeIsLeapYear(int year); 
 static void TimeGetYear(uint64_t ms, int * years_passed, int * days_passed);
 static void TimeMonthCalc(int year, int day, int * out_month, int * out_days);
 
-int64_t DateHelpers::GetTimeZoneOffset()
+static int64_t TimeZoneRefresh(uint64_t now)
 {
+    int64_t offset;
+
     if (!sys_tz)
         sys_tz = (timezone *)kallsyms_lookup_name("sys_tz");
 
-    if (!sys_tz)
-        return 0;
+    offset = sys_tz ? -int64_t(sys_tz->tz_minuteswest) * 60000 : 0;
+
+    // someone else is already refreshing; their value is as good as ours
+    if (!tz_lock.TryWriteLock())
+        return offset;
+
+    tz_cache.offset    = offset;
+    tz_cache.refreshed = now;
+    tz_lock.WriteUnlock();
+
+    return offset;
+}
+
+int64_t DateHelpers::GetTimeZoneOffset()
+{
+    uint32_t seq;
+    int64_t offset;
+    uint64_t refreshed;
+    uint64_t now;
+
+    do
+    {
+        seq       = tz_lock.ReadBegin();
+        offset    = tz_cache.offset;
+        refreshed = tz_cache.refreshed;
+    } while (tz_lock.ReadRetry(seq));
+
+    now = GetBootTime();
 
-    if (tz_offset != -1)
-        return tz_offset;
+    if (refreshed && (now - refreshed < TZ_REFRESH_NS))
+        return offset;
 
-    return tz_offset = -sys_tz->tz_minuteswest * 60000;
+    return TimeZoneRefresh(now);
 }
 
 uint64_t DateHelpers::GetUnixTime()
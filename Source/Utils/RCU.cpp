@@ -6,6 +6,31 @@
 #include <libos.hpp>
 #include "RCU.hpp"
 
+struct DeferredFreeEntry
+{
+    RCU::Head head;
+    void * buffer;
+};
+
+static sysv_fptr_t rcu_callback_sysv;
+static void * rcu_callback_handle;
+
+DEFINE_SYSV_FUNCTON_START(rcu_deferred_callback, size_t)
+    void * head,
+    uint64_t pad_1,
+    uint64_t pad_2,
+    uint64_t pad_3, // theres a 4 argument prerequisite for dynamic callbacks to work
+DEFINE_SYSV_FUNCTON_END_DEF(rcu_deferred_callback, size_t)
+{
+    RCU::Head * entry;
+    
+    entry = reinterpret_cast<RCU::Head *>(head);
+    entry->callback(entry);
+
+    SYSV_FUNCTON_RETURN(0)
+}
+DEFINE_SYSV_END
+
 void RCU::ReadLock()
 {
     // no compiler warning
@@ -19,3 +44,58 @@ void RCU::ReadUnlock()
     // no dep map support
     __rcu_read_unlock();
 }
+
+void RCU::Synchronize()
+{
+    synchronize_rcu();
+}
+
+void RCU::Barrier()
+{
+    rcu_barrier();
+}
+
+void RCU::DeferredCall(RCU::Head * head, RCU::Callback_f callback)
+{
+    head->callback = callback;
+    call_rcu(reinterpret_cast<void *>(head), rcu_callback_sysv);
+}
+
+static void DeferredFreeCallback(RCU::Head * head)
+{
+    DeferredFreeEntry * entry;
+
+    entry = reinterpret_cast<DeferredFreeEntry *>(head);
+
+    free(entry->buffer);
+    free(entry);
+}
+
+void RCU::DeferredFree(void * buffer)
+{
+    DeferredFreeEntry * entry;
+
+    if (!buffer)
+        return;
+
+    entry = reinterpret_cast<DeferredFreeEntry *>(zalloc(sizeof(DeferredFreeEntry)));
+    
+    // out of memory: do it the slow way
+    if (!entry)
+    {
+        Synchronize();
+        free(buffer);
+        return;
+    }
+
+    entry->buffer = buffer;
+    DeferredCall(&entry->head, DeferredFreeCallback);
+}
+
+void RCU::InitRCU()
+{
+    error_t err;
+
+    err = dyncb_allocate_stub(SYSV_FN(rcu_deferred_callback), 4, nullptr, &rcu_callback_sysv, &rcu_callback_handle);
+    ASSERT(NO_ERROR(err), "couldn't allocate rcu callback stub: " PRINTF_ERROR, err);
+}
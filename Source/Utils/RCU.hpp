@@ -4,9 +4,47 @@
     License: All Rights Reserved J. Reece Wilson (See License.txt)
 */
 #pragma once
+#include <Core/CPU/OMemoryCoherency.hpp>
 
 namespace RCU
 {
+    struct Head;
+    typedef void(*Callback_f)(Head * head);
+
+    // embed in anything that should be reclaimed after a grace period. next/func mirror struct rcu_head and belong to the kernel until the callback runs
+    struct Head
+    {
+        void * next;
+        void * func;
+        Callback_f callback;
+    };
+
     extern void ReadLock();
     extern void ReadUnlock();
+
+    extern void Synchronize();                                  // synchronize_rcu - sleeps until every pre-existing reader has finished
+    extern void Barrier();                                      // rcu_barrier - waits for every queued DeferredCall to run
+
+    extern void DeferredCall(Head * head, Callback_f callback); // call_rcu - callback runs in softirq context after a grace period
+    extern void DeferredFree(void * buffer);                    // free() after a grace period
+
+    // publish/subscribe helpers for RCU protected pointers. x86 only needs the compiler kept in check
+    template<typename T>
+    static inline void AssignPointer(T * volatile & slot, T * value)
+    {
+        CPU::Memory::ReadWriteBarrier();
+        slot = value;
+    }
+
+    template<typename T>
+    static inline T * Dereference(T * volatile const & slot)
+    {
+        T * value;
+
+        value = slot;
+        CPU::Memory::ReadWriteBarrier();
+        return value;
+    }
+
+    extern void InitRCU();
 }
@@ -0,0 +1,173 @@
+/*
+    Purpose: Fixed size, chained hash map with lock-free RCU readers and spinlock serialized writers
+    Author: Reece W.
+    License: All Rights Reserved J. Reece Wilson (See License.txt)
+*/
+#pragma once
+#include <Core/Synchronization/OSpinlock.hpp>
+#include "RCU.hpp"
+
+// T is copied in and out by value and must be trivially copyable (typically a pointer or a small struct).
+// Removed nodes are reclaimed after a grace period, but anything T points to is the callers problem - use RCU::Synchronize or RCU::DeferredCall before freeing it.
+template<typename T>
+class RCUHashMap
+{
+public:
+    RCUHashMap() : _buckets(nullptr), _mask(0), _count(0)
+    {}
+
+    error_t Init(size_t buckets) // rounded up to a power of two
+    {
+        size_t size;
+
+        if (_buckets)
+            return kErrorInternalError;
+
+        for (size = 1; size < buckets; size <<= 1);
+
+        _buckets = reinterpret_cast<Node * volatile *>(zalloc(sizeof(Node *) * size));
+        if (!_buckets)
+            return kErrorOutOfMemory;
+
+        _mask = size - 1;
+        return kStatusOkay;
+    }
+
+    // safe with or without an outer RCU::ReadLock; hold one across the lookup and the use of out if T points to RCU managed memory
+    bool Lookup(uint64_t key, T & out)
+    {
+        bool found;
+
+        found = false;
+
+        RCU::ReadLock();
+        for (Node * cur = RCU::Dereference(_buckets[Hash(key)]); cur; cur = RCU::Dereference(cur->next))
+        {
+            if (cur->key == key)
+            {
+                out   = cur->value;
+                found = true;
+                break;
+            }
+        }
+        RCU::ReadUnlock();
+
+        return found;
+    }
+
+    bool Contains(uint64_t key)
+    {
+        T ignored;
+        return Lookup(key, ignored);
+    }
+
+    // kStatusLinkPresent if the key already exists (the existing value is left untouched)
+    error_t Insert(uint64_t key, const T & value)
+    {
+        Node * node;
+        Node * volatile * bucket;
+
+        node = reinterpret_cast<Node *>(zalloc(sizeof(Node)));
+        if (!node)
+            return kErrorOutOfMemory;
+
+        node->key   = key;
+        node->value = value;
+
+        bucket = &_buckets[Hash(key)];
+
+        _writer.Lock();
+
+        for (Node * cur = *bucket; cur; cur = cur->next)
+        {
+            if (cur->key == key)
+            {
+                _writer.Unlock();
+                free(node);
+                return kStatusLinkPresent;
+            }
+        }
+
+        // fully initialize before publishing; readers may pick the node up immediately
+        node->next = *bucket;
+        RCU::AssignPointer(*bucket, node);
+        _count++;
+
+        _writer.Unlock();
+        return kStatusOkay;
+    }
+
+    error_t Remove(uint64_t key, T * old = nullptr)
+    {
+        Node * cur;
+        Node * volatile * link;
+
+        _writer.Lock();
+
+        for (link = &_buckets[Hash(key)]; (cur = *link) != nullptr; link = &cur->next)
+        {
+            if (cur->key == key)
+                break;
+        }
+
+        if (!cur)
+        {
+            _writer.Unlock();
+            return kErrorLinkNotFound;
+        }
+
+        // readers already on cur still see a valid next pointer
+        RCU::AssignPointer(*link, static_cast<Node *>(cur->next));
+        _count--;
+
+        _writer.Unlock();
+
+        if (old)
+            *old = cur->value;
+
+        RCU::DeferredCall(&cur->rcu, FreeNode);
+        return kStatusOkay;
+    }
+
+    // callback(key, value, context); runs under RCU::ReadLock and must not sleep
+    template<typename F>
+    void ForEach(F callback, void * context)
+    {
+        RCU::ReadLock();
+        for (size_t i = 0; i <= _mask; i++)
+        {
+            for (Node * cur = RCU::Dereference(_buckets[i]); cur; cur = RCU::Dereference(cur->next))
+                callback(cur->key, cur->value, context);
+        }
+        RCU::ReadUnlock();
+    }
+
+    size_t Count()
+    {
+        return _count;
+    }
+
+private:
+    struct Node
+    {
+        RCU::Head rcu;  // must remain first
+        Node * volatile next;
+        uint64_t key;
+        T value;
+    };
+
+    static void FreeNode(RCU::Head * head)
+    {
+        free(head);
+    }
+
+    size_t Hash(uint64_t key)
+    {
+        return size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & _mask;
+    }
+
+    Node * volatile * _buckets;
+    size_t _mask;
+    volatile size_t _count;
+    Synchronization::Spinlock _writer;
+};